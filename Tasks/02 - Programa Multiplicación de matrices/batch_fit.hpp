@@ -0,0 +1,420 @@
+// batch_fit.hpp
+// Motor de ajustes por lotes compartido por main-ecnormal-modelo-lineal.cpp y
+// main-ecnormal-modelo-cuadratico.cpp (opción --batch):
+// - load_series: lee un archivo (series_id, x, y) y agrupa cada serie en un
+//   tramo contiguo de x[] e y[]
+// - parallel_series: reparte las series entre hilos con robo de trabajo
+//   (work stealing); cada hilo tiene su propio scratch, reservado una vez
+// - write_fit_results: escribe un CSV con una fila por serie
+// - read_points: lee un solo conjunto de puntos "x,y[,w]" (--data)
+// - read_responses / write_response_results: varias respuestas y_1..y_k
+//   sobre la misma x (opción --multi: una sola factorización, nrhs = k)
+// - read_fit_job: las mismas x e Y desde un trabajo kJobFit de --serve
+//
+// BLAS se fija a un hilo mientras trabajan los hilos del pool (evita
+// sobresuscripción) y se restaura al terminar.
+#pragma once
+
+#include "matmul_core.hpp" // MappedFile, blas_set_num_threads, max_threads
+#include "../../include/mcs/server.hpp" // JobInput
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// -----------------------------
+// Tabla de series
+//
+// Entrada: una fila por muestra, "series_id,x,y" (comas o espacios). Se
+// admite una línea de encabezado y comentarios con '#'. Las series se
+// numeran por orden de primera aparición; si las filas de una serie no
+// vienen seguidas, se reordenan (counting sort estable) para que cada
+// serie quede contigua: x[offsets[s] .. offsets[s+1]).
+// -----------------------------
+struct SeriesTable {
+    MappedFile map;                    // los ids apuntan al archivo mapeado
+    std::vector<std::string_view> ids; // id de cada serie
+    std::vector<size_t> offsets;       // ids.size() + 1
+    std::vector<double> x, y;
+    size_t max_len = 0;
+
+    size_t count() const { return ids.size(); }
+    size_t length(size_t s) const { return offsets[s + 1] - offsets[s]; }
+};
+
+inline bool is_field_sep(char c) { return c == ',' || c == ' ' || c == '\t' || c == '\r'; }
+
+// Siguiente campo de la línea [p, le): deja p después del separador
+inline std::string_view next_field(const char*& p, const char* le) {
+    while (p < le && is_field_sep(*p)) ++p;
+    const char* b = p;
+    while (p < le && !is_field_sep(*p)) ++p;
+    return std::string_view(b, static_cast<size_t>(p - b));
+}
+
+inline bool field_to_double(std::string_view f, double& v) {
+    const char* b = f.data();
+    const char* e = b + f.size();
+    if (b < e && *b == '+') ++b;
+    const auto r = std::from_chars(b, e, v);
+    return r.ec == std::errc{} && r.ptr == e;
+}
+
+inline void load_series(const std::string& path, SeriesTable& t) {
+    t.map.open_read(path);
+    const char* p = t.map.data();
+    const char* end = p + t.map.size();
+
+    std::unordered_map<std::string_view, uint32_t> index;
+    std::vector<uint32_t> row_series;
+    std::vector<double> xs, ys;
+    bool contiguous = true;
+    uint32_t last = UINT32_MAX;
+    long long line_no = 0;
+
+    while (p < end) {
+        const char* nl = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+        const char* le = nl ? nl : end;
+        ++line_no;
+        const char* q = p;
+        p = nl ? nl + 1 : end;
+
+        const std::string_view id = next_field(q, le);
+        if (id.empty() || id.front() == '#') continue;
+        double xi = 0.0, yi = 0.0;
+        const bool ok = field_to_double(next_field(q, le), xi) && field_to_double(next_field(q, le), yi);
+        if (!ok) {
+            if (line_no == 1) continue; // encabezado
+            throw std::runtime_error("Registro inválido en la línea " + std::to_string(line_no) +
+                                     ". Se espera: series_id,x,y");
+        }
+
+        const auto [it, inserted] = index.try_emplace(id, static_cast<uint32_t>(t.ids.size()));
+        if (inserted) t.ids.push_back(id);
+        if (!inserted && it->second != last) contiguous = false;
+        last = it->second;
+        row_series.push_back(it->second);
+        xs.push_back(xi);
+        ys.push_back(yi);
+    }
+
+    // Conteo por serie => offsets
+    const size_t S = t.ids.size();
+    t.offsets.assign(S + 1, 0);
+    for (uint32_t s : row_series) ++t.offsets[s + 1];
+    for (size_t s = 0; s < S; ++s) {
+        t.max_len = std::max(t.max_len, t.offsets[s + 1]);
+        t.offsets[s + 1] += t.offsets[s];
+    }
+
+    if (contiguous) {
+        t.x = std::move(xs);
+        t.y = std::move(ys);
+        return;
+    }
+    // Reordenar filas por serie (estable: conserva el orden dentro de cada serie)
+    t.x.resize(xs.size());
+    t.y.resize(ys.size());
+    std::vector<size_t> pos(t.offsets.begin(), t.offsets.end() - 1);
+    for (size_t r = 0; r < row_series.size(); ++r) {
+        const size_t d = pos[row_series[r]]++;
+        t.x[d] = xs[r];
+        t.y[d] = ys[r];
+    }
+}
+
+// Lee un archivo de puntos "x,y" (comas o espacios; encabezado y '#' opcionales).
+// Con w != nullptr cada línea lleva además un peso: "x,y,w"
+inline void read_points(const std::string& path, std::vector<double>& x, std::vector<double>& y,
+                        std::vector<double>* w = nullptr) {
+    MappedFile map;
+    map.open_read(path);
+    const char* p = map.data();
+    const char* end = p + map.size();
+    long long line_no = 0;
+    x.clear();
+    y.clear();
+    if (w) w->clear();
+    while (p < end) {
+        const char* nl = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+        const char* le = nl ? nl : end;
+        ++line_no;
+        const char* q = p;
+        p = nl ? nl + 1 : end;
+
+        const std::string_view fx = next_field(q, le);
+        if (fx.empty() || fx.front() == '#') continue;
+        double xi = 0.0, yi = 0.0, wi = 1.0;
+        if (!field_to_double(fx, xi) || !field_to_double(next_field(q, le), yi) ||
+            (w && (!field_to_double(next_field(q, le), wi) || wi < 0.0))) {
+            if (line_no == 1) continue; // encabezado
+            throw std::runtime_error("Registro inválido en la línea " + std::to_string(line_no) +
+                                     (w ? ". Se espera: x,y,w (w >= 0)" : ". Se espera: x,y"));
+        }
+        x.push_back(xi);
+        y.push_back(yi);
+        if (w) w->push_back(wi);
+    }
+}
+
+// -----------------------------
+// Tabla de respuestas (--multi)
+//
+// Entrada: una fila por x, "x,y_1,...,y_k" (comas o espacios; '#' para
+// comentarios). Si la primera línea no es numérica, es el encabezado y da
+// los nombres de las respuestas; si no, se llaman y1..yk. k lo fija la
+// primera fila de datos. Y queda en column-major (m×k, ld = m), que es
+// justo el B de nrhs = k columnas que esperan dgels y dposv.
+// -----------------------------
+struct ResponseTable {
+    std::vector<std::string> names; // k nombres
+    std::vector<double> x;          // m
+    std::vector<double> Y;          // m×k column-major
+
+    size_t rows() const { return x.size(); }
+    size_t count() const { return names.size(); }
+    const double* column(size_t j) const { return Y.data() + j * rows(); }
+};
+
+inline void read_responses(const std::string& path, ResponseTable& t) {
+    MappedFile map;
+    map.open_read(path);
+    const char* p = map.data();
+    const char* end = p + map.size();
+    std::vector<std::string> header;
+    std::vector<double> rows; // fila a fila (row-major) hasta conocer m
+    size_t k = 0;
+    long long line_no = 0;
+    while (p < end) {
+        const char* nl = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+        const char* le = nl ? nl : end;
+        ++line_no;
+        const char* q = p;
+        p = nl ? nl + 1 : end;
+
+        std::string_view f = next_field(q, le);
+        if (f.empty() || f.front() == '#') continue;
+        double v = 0.0;
+        if (line_no == 1 && !field_to_double(f, v)) {
+            while (!(f = next_field(q, le)).empty()) header.emplace_back(f);
+            continue;
+        }
+        size_t fields = 0;
+        for (; !f.empty(); f = next_field(q, le), ++fields) {
+            if (!field_to_double(f, v)) {
+                fields = 0;
+                break;
+            }
+            rows.push_back(v);
+        }
+        if (k == 0 && fields >= 2) k = fields - 1;
+        if (fields != k + 1 || k == 0)
+            throw std::runtime_error("Registro inválido en la línea " + std::to_string(line_no) +
+                                     ". Se espera: x,y_1,...,y_k" + (k ? " con k = " + std::to_string(k) : std::string()));
+    }
+    if (!header.empty() && header.size() != k)
+        throw std::runtime_error("El encabezado de " + path + " tiene " + std::to_string(header.size()) +
+                                 " respuestas y los datos " + std::to_string(k) + ".");
+
+    const size_t m = k ? rows.size() / (k + 1) : 0;
+    t.names = header;
+    for (size_t j = t.names.size(); j < k; ++j) t.names.push_back("y" + std::to_string(j + 1));
+    t.x.resize(m);
+    t.Y.resize(m * k);
+    for (size_t i = 0; i < m; ++i) {
+        const double* r = rows.data() + i * (k + 1);
+        t.x[i] = r[0];
+        for (size_t j = 0; j < k; ++j) t.Y[j * m + i] = r[j + 1];
+    }
+}
+
+// Trabajo kJobFit (--serve): x (m×1) e Y (m×k) en f64, en cualquier layout;
+// Y se entrega en column-major (transpuesta en Ybuf si llegó row-major)
+struct FitJob {
+    int m = 0, k = 0;
+    const double* x = nullptr;
+    const double* Y = nullptr; // m×k column-major
+};
+
+inline FitJob read_fit_job(const JobInput& in, AlignedBuffer<double>& Ybuf) {
+    in.expect(2, "x (m×1) e Y (m×k)");
+    FitJob job;
+    job.m = in.rows(0);
+    job.k = in.cols(1);
+    if (in.cols(0) != 1 || in.rows(1) != job.m)
+        throw std::runtime_error("Se espera x (m×1) e Y (m×k) con las mismas m filas.");
+    job.x = in.matrix<double>(0);
+    job.Y = in.col_major<double>(1, Ybuf);
+    return job;
+}
+
+// -----------------------------
+// Pool con robo de trabajo
+//
+// Cada hilo empieza con un rango contiguo de series [lo, hi), empaquetado en
+// un atomic de 64 bits. El dueño toma kStealGrain series del frente; un hilo
+// sin trabajo roba la mitad superior del rango de otro. Ambos usan CAS sobre
+// el mismo atomic, así que nunca se procesa una serie dos veces.
+// -----------------------------
+inline constexpr uint32_t kStealGrain = 16;
+
+class StealRanges {
+public:
+    StealRanges(size_t count, unsigned nthreads) : r_(nthreads) {
+        for (unsigned w = 0; w < nthreads; ++w) {
+            const uint32_t lo = static_cast<uint32_t>(count * w / nthreads);
+            const uint32_t hi = static_cast<uint32_t>(count * (w + 1) / nthreads);
+            r_[w].store(pack(lo, hi));
+        }
+    }
+
+    // Siguiente bloque [b, e) para el hilo w (propio o robado); false al terminar
+    bool next(unsigned w, uint32_t& b, uint32_t& e) {
+        if (pop_front(w, b, e)) return true;
+        const unsigned nt = static_cast<unsigned>(r_.size());
+        for (unsigned k = 1; k < nt; ++k) {
+            uint32_t sb = 0, se = 0;
+            if (steal_half((w + k) % nt, sb, se)) {
+                r_[w].store(pack(sb, se)); // mi rango estaba vacío: nadie más lo modifica
+                if (pop_front(w, b, e)) return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    static uint64_t pack(uint32_t lo, uint32_t hi) { return (static_cast<uint64_t>(hi) << 32) | lo; }
+    static uint32_t lo_of(uint64_t v) { return static_cast<uint32_t>(v); }
+    static uint32_t hi_of(uint64_t v) { return static_cast<uint32_t>(v >> 32); }
+
+    bool pop_front(unsigned w, uint32_t& b, uint32_t& e) {
+        uint64_t v = r_[w].load();
+        for (;;) {
+            const uint32_t lo = lo_of(v), hi = hi_of(v);
+            if (lo >= hi) return false;
+            const uint32_t nlo = std::min(hi, lo + kStealGrain);
+            if (r_[w].compare_exchange_weak(v, pack(nlo, hi))) {
+                b = lo;
+                e = nlo;
+                return true;
+            }
+        }
+    }
+
+    bool steal_half(unsigned victim, uint32_t& b, uint32_t& e) {
+        uint64_t v = r_[victim].load();
+        for (;;) {
+            const uint32_t lo = lo_of(v), hi = hi_of(v);
+            if (lo >= hi) return false;
+            const uint32_t mid = lo + (hi - lo) / 2;
+            if (r_[victim].compare_exchange_weak(v, pack(lo, mid))) {
+                b = mid;
+                e = hi;
+                return true;
+            }
+        }
+    }
+
+    std::vector<std::atomic<uint64_t>> r_;
+};
+
+// Llama fit(s, scratch) para cada serie s. Cada hilo copia `proto` una sola
+// vez (su scratch), así que los ajustes no reservan memoria.
+template <class Scratch, class Fit>
+inline void parallel_series(size_t count, const Scratch& proto, Fit&& fit) {
+    if (count > UINT32_MAX) throw std::runtime_error("Demasiadas series en el lote.");
+    const unsigned hw = max_threads();
+    const unsigned nthreads = static_cast<unsigned>(std::min<size_t>(hw, std::max<size_t>(1, count)));
+    StealRanges ranges(count, nthreads);
+
+    const int blas_threads = blas_get_num_threads();
+    blas_set_num_threads(1);
+    auto worker = [&](unsigned w) {
+        if (nthreads > 1) bind_worker(w);
+        Scratch scratch = proto;
+        uint32_t b = 0, e = 0;
+        while (ranges.next(w, b, e))
+            for (uint32_t s = b; s < e; ++s) fit(static_cast<size_t>(s), scratch);
+    };
+    std::vector<std::thread> pool;
+    for (unsigned w = 1; w < nthreads; ++w) pool.emplace_back(worker, w);
+    worker(0);
+    for (auto& th : pool) th.join();
+    blas_set_num_threads(blas_threads);
+}
+
+// -----------------------------
+// Salida: "<id_col>,count,<param...>,sse" (NaN si la fila no se pudo ajustar)
+//
+// write_fit_rows escribe `rows` filas; id(s) y length(s) dan el nombre y el
+// número de puntos de cada una. write_fit_results (--batch) usa los ids y
+// largos de la tabla de series; write_response_results (--multi), los
+// nombres de las respuestas (todas con los mismos m puntos).
+// -----------------------------
+template <class Id, class Length>
+inline void write_fit_rows(const std::string& path, const char* id_col, size_t rows, Id&& id, Length&& length,
+                           const std::vector<std::string>& param_names, const std::vector<double>& results) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) throw std::runtime_error("No se pudo abrir el archivo de salida: " + path);
+    const size_t np = param_names.size() + 1; // parámetros + sse
+
+    std::string header = std::string(id_col) + ",count";
+    for (const auto& name : param_names) header += "," + name;
+    header += ",sse\n";
+    out << header;
+
+    std::vector<char> buf;
+    for (size_t s = 0; s < rows; ++s) {
+        if (buf.size() > (size_t{1} << 20)) {
+            out.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+            buf.clear();
+        }
+        const std::string_view name = id(s);
+        const size_t pos = buf.size();
+        buf.resize(pos + name.size() + 24 + np * 25);
+        char* p = buf.data() + pos;
+        p = std::copy(name.begin(), name.end(), p);
+        *p++ = ',';
+        p = std::to_chars(p, p + 24, static_cast<size_t>(length(s))).ptr;
+        for (size_t k = 0; k < np; ++k) {
+            *p++ = ',';
+            const double v = results[s * np + k];
+            if (std::isnan(v)) {
+                std::memcpy(p, "nan", 3);
+                p += 3;
+            } else {
+                p = std::to_chars(p, p + 24, v).ptr;
+            }
+        }
+        *p++ = '\n';
+        buf.resize(static_cast<size_t>(p - buf.data()));
+    }
+    out.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+    if (!out) throw std::runtime_error("Error escribiendo " + path);
+}
+
+inline void write_fit_results(const std::string& path, const SeriesTable& t,
+                              const std::vector<std::string>& param_names,
+                              const std::vector<double>& results) {
+    write_fit_rows(
+        path, "series_id", t.count(), [&](size_t s) { return t.ids[s]; }, [&](size_t s) { return t.length(s); },
+        param_names, results);
+}
+
+inline void write_response_results(const std::string& path, const ResponseTable& t,
+                                   const std::vector<std::string>& param_names,
+                                   const std::vector<double>& results) {
+    write_fit_rows(
+        path, "response", t.count(), [&](size_t j) { return std::string_view(t.names[j]); },
+        [&](size_t) { return t.rows(); }, param_names, results);
+}
@@ -0,0 +1,284 @@
+// bench-multiplicacion.cpp
+// Benchmark de C = A*B: DGEMM (OpenBLAS) vs triple bucle ingenuo vs kernel
+// por bloques (cache-blocked, vectorizable por el compilador).
+//
+// Para cada forma (cuadradas y alargadas) mide, en segundos (mejor de R
+// repeticiones):
+// - parse   : parsear A y B desde su texto "m n l / A / B" (en memoria)
+// - convert : copias row-major <-> column-major (to_col_major de A y B,
+//             to_row_major de C) con el doble bucle ingenuo, el camino
+//             anterior a la versión sin copias
+// - convert_blocked : las mismas copias con la transposición por bloques
+//             de matmul_core.hpp; transpose_inplace: en sitio (solo cuadradas)
+// - dgemm   : gemm_layouts (DGEMM directo sobre los buffers row-major)
+// - naive   : triple bucle i-j-k (se omite si la forma es grande)
+// - blocked : kernel por bloques i-k-j
+// - write   : formatear C como texto (write_matrix_row_major, sin disco)
+// y GFLOP/s = 2*m*n*l / t. La salida es CSV por stdout.
+//
+// Hilos: el número de hilos de OpenBLAS se toma de OPENBLAS_NUM_THREADS
+// (columna "threads"); con --threads 1,2,4 se barre esa lista dentro del
+// mismo proceso con blas_set_num_threads.
+//
+// Compilar (MSYS2 UCRT64):
+//   g++ -std=c++23 -O3 -march=native -Wall -Wextra bench-multiplicacion.cpp -o bench.exe -lopenblas
+//
+// Ejecutar:
+//   ./bench.exe > bench.csv
+//   OPENBLAS_NUM_THREADS=1 ./bench.exe --max 1024
+//   ./bench.exe --threads 1,2,4,8 --reps 5
+
+#include "matmul_core.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+struct Shape {
+    const char* kind;
+    int m, n, l;
+};
+
+// Barrido por defecto: cuadradas y alargadas (tall/skinny y producto interno largo)
+static const Shape kShapes[] = {
+    {"square", 128, 128, 128},
+    {"square", 256, 256, 256},
+    {"square", 512, 512, 512},
+    {"square", 1024, 1024, 1024},
+    {"square", 2048, 2048, 2048},
+    {"square", 4096, 4096, 4096},
+    {"tall", 8192, 64, 64},
+    {"tall", 32768, 128, 32},
+    {"tall", 65536, 256, 256},
+    {"skinny", 64, 8192, 64},
+    {"skinny", 256, 65536, 256},
+    {"wide", 64, 64, 8192},
+};
+
+// El triple bucle ingenuo solo se mide hasta este número de multiplicaciones
+static constexpr double kNaiveMaxFlops = 512.0 * 512.0 * 512.0;
+
+// Streambuf que descarta los bytes (mide el formateo, no el disco)
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override { return c; }
+    std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+};
+
+// Copias de layout del camino anterior (row-major <-> column-major)
+static void to_col_major_naive(const double* rm, int rows, int cols, double* cm) {
+    for (int i = 0; i < rows; ++i)
+        for (int j = 0; j < cols; ++j)
+            cm[static_cast<size_t>(j) * rows + i] = rm[static_cast<size_t>(i) * cols + j];
+}
+
+static void to_row_major_naive(const double* cm, int rows, int cols, double* rm) {
+    for (int i = 0; i < rows; ++i)
+        for (int j = 0; j < cols; ++j)
+            rm[static_cast<size_t>(i) * cols + j] = cm[static_cast<size_t>(j) * rows + i];
+}
+
+// C = A*B, triple bucle i-j-k (A y B row-major; B se recorre por columnas)
+static void gemm_naive(const double* A, const double* B, double* C, int m, int n, int l) {
+    for (int i = 0; i < m; ++i)
+        for (int j = 0; j < l; ++j) {
+            double sum = 0.0;
+            for (int k = 0; k < n; ++k)
+                sum += A[static_cast<size_t>(i) * n + k] * B[static_cast<size_t>(k) * l + j];
+            C[static_cast<size_t>(i) * l + j] = sum;
+        }
+}
+
+// C = A*B por bloques (MC×KC de A, KC×NC de B). El bucle interno recorre una
+// fila de B y de C de forma contigua, así que el compilador lo vectoriza
+// (SIMD) con -O3 -march=native; los bloques mantienen B en caché.
+static constexpr int kMC = 64;
+static constexpr int kKC = 256;
+static constexpr int kNC = 1024;
+
+static void gemm_blocked(const double* __restrict A, const double* __restrict B, double* __restrict C,
+                         int m, int n, int l) {
+    std::fill(C, C + static_cast<size_t>(m) * l, 0.0);
+    for (int j0 = 0; j0 < l; j0 += kNC) {
+        const int j1 = std::min(l, j0 + kNC);
+        for (int k0 = 0; k0 < n; k0 += kKC) {
+            const int k1 = std::min(n, k0 + kKC);
+            for (int i0 = 0; i0 < m; i0 += kMC) {
+                const int i1 = std::min(m, i0 + kMC);
+                for (int i = i0; i < i1; ++i) {
+                    double* __restrict c = C + static_cast<size_t>(i) * l;
+                    const double* a = A + static_cast<size_t>(i) * n;
+                    for (int k = k0; k < k1; ++k) {
+                        const double aik = a[k];
+                        const double* __restrict b = B + static_cast<size_t>(k) * l;
+                        for (int j = j0; j < j1; ++j) c[j] += aik * b[j];
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Mejor tiempo (s) de `reps` ejecuciones de fn
+template <class F>
+static double best_time(int reps, F&& fn) {
+    double best = 1e300;
+    for (int r = 0; r < reps; ++r) {
+        const auto t0 = std::chrono::steady_clock::now();
+        fn();
+        const auto t1 = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double>(t1 - t0).count());
+    }
+    return best;
+}
+
+static double max_abs_diff(const std::vector<double>& x, const std::vector<double>& y) {
+    double d = 0.0;
+    for (size_t i = 0; i < x.size(); ++i) d = std::max(d, std::fabs(x[i] - y[i]));
+    return d;
+}
+
+// Mismo formato que el resto de columnas (6 cifras significativas)
+static std::string csv_num(double v) {
+    std::ostringstream os;
+    os << v;
+    return os.str();
+}
+
+static std::vector<int> parse_int_list(const std::string& s) {
+    std::vector<int> out;
+    size_t pos = 0;
+    while (pos < s.size()) {
+        const size_t comma = s.find(',', pos);
+        const std::string tok = s.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+        const int v = std::atoi(tok.c_str());
+        if (v <= 0) throw std::runtime_error("Lista de enteros inválida: " + s);
+        out.push_back(v);
+        if (comma == std::string::npos) break;
+        pos = comma + 1;
+    }
+    return out;
+}
+
+int main(int argc, char** argv) {
+    try {
+        int reps = 3;
+        long long max_dim = 1LL << 40; // sin límite
+        std::vector<int> thread_list;  // vacío => lo que diga OPENBLAS_NUM_THREADS
+        for (int i = 1; i < argc; ++i) {
+            const std::string a = argv[i];
+            if (a == "--reps" && i + 1 < argc) {
+                reps = std::max(1, std::atoi(argv[++i]));
+            } else if (a == "--max" && i + 1 < argc) {
+                max_dim = std::atoll(argv[++i]);
+            } else if (a == "--threads" && i + 1 < argc) {
+                thread_list = parse_int_list(argv[++i]);
+            } else {
+                std::cerr << "Uso: " << argv[0] << " [--reps R] [--max N] [--threads 1,2,4]\n";
+                return 1;
+            }
+        }
+        if (thread_list.empty()) thread_list.push_back(blas_get_num_threads());
+
+        std::cout << "kind,m,n,l,threads,parse_s,convert_s,convert_blocked_s,transpose_inplace_s,dgemm_s,dgemm_gflops,"
+                     "naive_s,naive_gflops,blocked_s,blocked_gflops,blocked_max_err,write_s\n";
+
+        std::mt19937_64 rng(12345);
+        std::uniform_real_distribution<double> dist(-1.0, 1.0);
+        NullBuffer null_buf;
+        std::ostream null_out(&null_buf);
+
+        for (const Shape& sh : kShapes) {
+            const int m = sh.m, n = sh.n, l = sh.l;
+            if (std::max({m, n, l}) > max_dim) continue;
+
+            std::vector<double> A(static_cast<size_t>(m) * n), B(static_cast<size_t>(n) * l);
+            for (auto& v : A) v = dist(rng);
+            for (auto& v : B) v = dist(rng);
+
+            // Texto de entrada equivalente a un input.txt, para medir el parseo
+            const std::string dims = std::to_string(m) + " " + std::to_string(n) + " " + std::to_string(l) + "\n";
+            std::vector<char> text(dims.size() + (A.size() + B.size()) * (kMaxDoubleChars + 1));
+            {
+                char* p = std::copy(dims.begin(), dims.end(), text.data());
+                p += format_rows(p, A.data(), 0, m, n);
+                p += format_rows(p, B.data(), 0, n, l);
+                text.resize(static_cast<size_t>(p - text.data()));
+            }
+
+            std::vector<double> Ap(A.size()), Bp(B.size());
+            const double t_parse = best_time(reps, [&] {
+                const char* p = text.data();
+                const char* end = p + text.size();
+                int pm = 0, pn = 0, pl = 0;
+                parse_text_dims(p, end, pm, pn, pl);
+                parse_text_matrices(p, end, pm, pn, pl, Ap.data(), Bp.data());
+            });
+
+            std::vector<double> Acm(A.size()), Bcm(B.size()), C(static_cast<size_t>(m) * l), Crm(C.size());
+            const double t_convert = best_time(reps, [&] {
+                to_col_major_naive(A.data(), m, n, Acm.data());
+                to_col_major_naive(B.data(), n, l, Bcm.data());
+                to_row_major_naive(C.data(), m, l, Crm.data());
+            });
+            const double t_convert_blocked = best_time(reps, [&] {
+                to_col_major(A.data(), m, n, Acm.data());
+                to_col_major(B.data(), n, l, Bcm.data());
+                to_row_major(C.data(), m, l, Crm.data());
+            });
+            std::string t_inplace;
+            if (m == n) t_inplace = csv_num(best_time(reps, [&] { transpose_inplace_square(Acm.data(), m); }));
+
+            const double flops = 2.0 * m * n * l;
+            const double half_flops = flops / 2.0;
+
+            for (const int threads : thread_list) {
+                blas_set_num_threads(threads);
+
+                const double t_dgemm = best_time(reps, [&] {
+                    gemm_layouts(A.data(), kLayoutRow, B.data(), kLayoutRow, C.data(), kLayoutRow, m, n, l);
+                });
+
+                // Los kernels de referencia son de un hilo: se miden una sola vez por forma
+                std::string naive_s, naive_gf, blocked_s, blocked_gf, blocked_err;
+                if (threads == thread_list.front()) {
+                    std::vector<double> Cref(C.size());
+                    if (half_flops <= kNaiveMaxFlops) {
+                        const double t = best_time(reps, [&] { gemm_naive(A.data(), B.data(), Cref.data(), m, n, l); });
+                        naive_s = csv_num(t);
+                        naive_gf = csv_num(flops / t * 1e-9);
+                    }
+                    const double t = best_time(reps, [&] { gemm_blocked(A.data(), B.data(), Cref.data(), m, n, l); });
+                    blocked_s = csv_num(t);
+                    blocked_gf = csv_num(flops / t * 1e-9);
+                    char buf[32];
+                    std::snprintf(buf, sizeof(buf), "%.3e", max_abs_diff(C, Cref));
+                    blocked_err = buf;
+                }
+
+                const double t_write = best_time(reps, [&] { write_matrix_row_major(null_out, C.data(), m, l); });
+
+                std::cout << sh.kind << ',' << m << ',' << n << ',' << l << ',' << threads << ','
+                          << t_parse << ',' << t_convert << ',' << t_convert_blocked << ',' << t_inplace << ','
+                          << t_dgemm << ',' << flops / t_dgemm * 1e-9 << ','
+                          << naive_s << ',' << naive_gf << ','
+                          << blocked_s << ',' << blocked_gf << ',' << blocked_err << ','
+                          << t_write << '\n'
+                          << std::flush;
+            }
+        }
+        return 0;
+
+    } catch (const std::exception& ex) {
+        std::cerr << "Error: " << ex.what() << "\n";
+        return 2;
+    }
+}
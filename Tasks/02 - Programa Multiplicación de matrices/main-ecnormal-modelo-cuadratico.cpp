@@ -4,61 +4,765 @@
 // usando LAPACK (LAPACKE_dgels) => resuelve directamente min ||A*theta - y||_2
 // (QR), sin formar A^T A (más estable que la ecuación normal).
 //
+// En general, un polinomio de grado d (--degree d, por defecto 2):
+//      y ≈ c_d φ_d(x) + ... + c_1 φ_1(x) + c_0
+// con base monomial φ_k = x^k (--basis poly) o de Chebyshev φ_k = T_k(t),
+// t = x escalado a [-1, 1] (--basis cheb, mejor condicionada para d alto).
+//
 // Datos (según la imagen):
 // (0,1.2), (1,2.0), (2,2.9), (3,4.1), (4,5.8), (5,8.2)
 //
 // Compilar (MSYS2 UCRT64):
 //   g++ -std=c++23 -O2 -Wall -Wextra main-ecnormal-modelo-cuadratico.cpp -o app3.exe -llapacke -lopenblas
+//   (con --serve en Windows, agregar -lws2_32)
 //
 // Ejecutar:
 //   ./app3.exe
+//   ./app3.exe --degree 3 --data puntos.txt        (puntos "x,y" de un archivo)
+//   ./app3.exe --degree 8 --basis cheb --data puntos.txt
+//   ./app3.exe --batch series.csv ajustes.csv (una parábola por serie; ver batch_fit.hpp)
+//   ./app3.exe --multi respuestas.csv ajustes.csv (k respuestas "x,y_1..y_k": una QR, nrhs = k)
+//   ./app3.exe --grid 10000000 --fit-format bin --fit-out fit.bin (curva densa, binario)
+//   ./app3.exe --data puntos.txt --points   (tabla por punto; por defecto solo con los datos de la imagen)
+//   cat nuevas.txt | ./app3.exe --data iniciales.txt --online - --forget 0.99
+//                                (actualiza R por muestra con Givens; ver online_ls.hpp)
+//   ./app3.exe --data puntos.txt --robust tukey     (IRLS contra valores atípicos)
+//   ./app3.exe --data puntos_w.txt --weights       (puntos "x,y,w": mínimos cuadrados ponderados)
+//   ./app3.exe --data puntos.txt --cache cache/    (reutiliza la QR si A ya se factorizó)
+//   ./app3.exe --serve unix:/tmp/mcs-fit.sock      (servidor de ajustes; ver server.hpp)
 //
 // Salida:
-// - coeficientes a,b,c
-// - tabla (x, y, y_hat, err)
-// - SSE, MSE
+// - coeficientes a,b,c (o c_d..c_0 para otro grado o base)
+// - tabla (x, y, y_hat, err), opcional (--points / --no-points)
+// - SSE, MSE (de los residuos que deja DGELS, sin reevaluar el modelo);
+//   con --weights/--robust, además el SSE ponderado y el resumen del IRLS
 // - genera "fit.csv" para graficar en Octave/Excel
 
-#include <lapacke.h>
+#include "../../include/mcs/factor_cache.hpp" // FactorCache, hash_matrix
+#include "../../include/mcs/lapack.hpp"       // gels, geqrf, ormqr, trtrs, lapack_check (incluye lapacke.h)
+#include "../../include/mcs/runtime.hpp"      // --threads, --bind, --backend
+#include "openblas/cblas.h" // cblas_dgemv
 
 #include <algorithm>
 #include <cmath>
+#include <cstdlib>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <limits>
 #include <stdexcept>
 #include <string>
 #include <vector>
 
-int main() {
+#include "batch_fit.hpp"
+#include "online_ls.hpp"
+
+// -----------------------------
+// Modelo: base y grado
+//
+// La columna j de A (j = 0..d) es φ_{d-j}(x): [x^d, ..., x, 1], igual que
+// el orden original [x^2, x, 1]. Las columnas se generan "al estilo Horner",
+// cada una a partir de la siguiente (x^k = x · x^(k-1)), sin llamar a pow.
+// -----------------------------
+enum class Basis { poly, cheb };
+
+struct Model {
+    Basis basis = Basis::poly;
+    int degree = 2;
+    double lo = -1.0, hi = 1.0; // intervalo de x que se mapea a [-1, 1] (cheb)
+
+    lapack_int params() const { return degree + 1; }
+    double scaled(double x) const { return (2.0 * x - (lo + hi)) / (hi - lo); }
+};
+
+// Llena A (m×n, column-major, leading dimension lda) para los x dados
+static void fill_design(const Model& md, const double* x, lapack_int m, double* A, lapack_int lda) {
+    const int d = md.degree;
+    double* col0 = A + static_cast<size_t>(d) * lda; // φ_0 = 1 (última columna)
+    for (lapack_int i = 0; i < m; ++i) col0[i] = 1.0;
+    if (d == 0) return;
+    double* col1 = A + static_cast<size_t>(d - 1) * lda; // φ_1
+    if (md.basis == Basis::poly) {
+        for (lapack_int i = 0; i < m; ++i) col1[i] = x[i];
+        for (int k = 2; k <= d; ++k) {
+            const double* prev = A + static_cast<size_t>(d - k + 1) * lda;
+            double* cur = A + static_cast<size_t>(d - k) * lda;
+            for (lapack_int i = 0; i < m; ++i) cur[i] = prev[i] * x[i];
+        }
+    } else {
+        // T_1 = t, T_k = 2 t T_{k-1} - T_{k-2}
+        for (lapack_int i = 0; i < m; ++i) col1[i] = md.scaled(x[i]);
+        for (int k = 2; k <= d; ++k) {
+            const double* p1 = A + static_cast<size_t>(d - k + 1) * lda;
+            const double* p2 = A + static_cast<size_t>(d - k + 2) * lda;
+            double* cur = A + static_cast<size_t>(d - k) * lda;
+            for (lapack_int i = 0; i < m; ++i) cur[i] = 2.0 * col1[i] * p1[i] - p2[i];
+        }
+    }
+}
+
+// -----------------------------
+// Evaluación por bloques sobre la malla
+//
+// Horner (o Clenshaw) se aplica a kEvalBlock puntos a la vez: el bucle
+// interno recorre los puntos, sin dependencias entre iteraciones, y el
+// compilador lo vectoriza (SIMD). Los bloques se reparten entre hilos.
+// -----------------------------
+static constexpr int kEvalBlock = 256;
+static constexpr size_t kGridRowsPerBlock = size_t{1} << 16; // filas de CSV por hilo y ronda
+
+// x de la malla: N puntos equiespaciados en [xmin, xmax]
+static double grid_x(size_t i, size_t N, double xmin, double xmax) {
+    const double t = static_cast<double>(i) / static_cast<double>(N - 1);
+    return xmin + t * (xmax - xmin);
+}
+
+// yv[i] = modelo(xv[i]) para i < len (len <= kEvalBlock); coef[j] multiplica
+// φ_{d-j}: Horner para la base monomial, Clenshaw para Chebyshev
+static void eval_block(const Model& md, const double* coef, const double* xv, double* yv, int len) {
+    const int d = md.degree;
+    if (md.basis == Basis::poly) {
+        for (int i = 0; i < len; ++i) yv[i] = coef[0];
+        for (int j = 1; j <= d; ++j) {
+            const double cj = coef[j];
+            for (int i = 0; i < len; ++i) yv[i] = yv[i] * xv[i] + cj;
+        }
+        return;
+    }
+    double t[kEvalBlock], b1[kEvalBlock], b2[kEvalBlock];
+    for (int i = 0; i < len; ++i) {
+        t[i] = md.scaled(xv[i]);
+        b1[i] = 0.0;
+        b2[i] = 0.0;
+    }
+    for (int j = 0; j < d; ++j) {
+        const double cj = coef[j];
+        for (int i = 0; i < len; ++i) {
+            const double b0 = cj + 2.0 * t[i] * b1[i] - b2[i];
+            b2[i] = b1[i];
+            b1[i] = b0;
+        }
+    }
+    for (int i = 0; i < len; ++i) yv[i] = coef[d] + t[i] * b1[i] - b2[i];
+}
+
+// Evalúa la malla [i0, i1) en xf[] e yf[] (índices relativos a i0)
+static void eval_grid(const Model& md, const double* coef, size_t i0, size_t i1, size_t N,
+                      double xmin, double xmax, double* xf, double* yf) {
+    for (size_t b = i0; b < i1; b += kEvalBlock) {
+        const int len = static_cast<int>(std::min<size_t>(kEvalBlock, i1 - b));
+        for (int i = 0; i < len; ++i) xf[b - i0 + i] = grid_x(b + i, N, xmin, xmax);
+        eval_block(md, coef, xf + (b - i0), yf + (b - i0), len);
+    }
+}
+
+// CSV "x_pts,y_pts,x_fit,y_fit": filas formateadas con to_chars en paralelo
+// (una ronda = un bloque de kGridRowsPerBlock filas por hilo) y escritas en orden
+static void write_fit_csv(const std::string& path, const std::vector<double>& x, const std::vector<double>& y,
+                          const Model& md, const double* coef, size_t N, double xmin, double xmax) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) throw std::runtime_error("No se pudo crear " + path);
+    out << "x_pts,y_pts,x_fit,y_fit\n";
+
+    const size_t rows = std::max(N, x.size());
+    const size_t nblocks = (rows + kGridRowsPerBlock - 1) / kGridRowsPerBlock;
+    const unsigned hw = max_threads();
+    std::vector<std::vector<char>> bufs(hw);
+    for (size_t r0 = 0; r0 < nblocks; r0 += hw) {
+        const size_t round = std::min<size_t>(hw, nblocks - r0);
+        parallel_for_tiles(round, rows, [&](size_t k) {
+            const size_t i0 = (r0 + k) * kGridRowsPerBlock;
+            const size_t i1 = std::min(rows, i0 + kGridRowsPerBlock);
+            std::vector<char>& buf = bufs[k];
+            buf.resize((i1 - i0) * 4 * (kMaxDoubleChars + 1));
+            double xf[kEvalBlock], yf[kEvalBlock];
+            char* p = buf.data();
+            for (size_t b = i0; b < i1; b += kEvalBlock) {
+                const size_t e = std::min(i1, b + kEvalBlock);
+                const size_t g1 = std::min(e, N); // filas de la malla dentro del bloque
+                if (b < g1) eval_grid(md, coef, b, g1, N, xmin, xmax, xf, yf);
+                for (size_t i = b; i < e; ++i) {
+                    // Puntos reales solo en las primeras x.size() filas; si no, vacío
+                    if (i < x.size()) {
+                        p = std::to_chars(p, p + kMaxDoubleChars, x[i]).ptr;
+                        *p++ = ',';
+                        p = std::to_chars(p, p + kMaxDoubleChars, y[i]).ptr;
+                    } else {
+                        *p++ = ',';
+                    }
+                    *p++ = ',';
+                    if (i < N) {
+                        p = std::to_chars(p, p + kMaxDoubleChars, xf[i - b]).ptr;
+                        *p++ = ',';
+                        p = std::to_chars(p, p + kMaxDoubleChars, yf[i - b]).ptr;
+                    } else {
+                        *p++ = ',';
+                    }
+                    *p++ = '\n';
+                }
+            }
+            buf.resize(static_cast<size_t>(p - buf.data()));
+        });
+        for (size_t k = 0; k < round; ++k) out.write(bufs[k].data(), static_cast<std::streamsize>(bufs[k].size()));
+    }
+    if (!out) throw std::runtime_error("Error escribiendo " + path);
+}
+
+// Binario columnar (contenedor MCSM, column-major): matriz 0 = puntos (m×2:
+// x_pts, y_pts), matriz 1 = curva (N×2: x_fit, y_fit). Cada columna queda
+// contigua; la curva se evalúa directamente en el archivo mapeado.
+static void write_fit_bin(const std::string& path, const std::vector<double>& x, const std::vector<double>& y,
+                          const Model& md, const double* coef, size_t N, double xmin, double xmax) {
+    BinHeader h = make_header(kLayoutCol, 2);
+    h.dims[0][0] = x.size(); h.dims[0][1] = 2;
+    h.dims[1][0] = N;        h.dims[1][1] = 2;
+    MappedFile out;
+    out.create(path, bin_file_size(h));
+    std::memcpy(out.data(), &h, sizeof(h));
+
+    double* pts = reinterpret_cast<double*>(out.data() + bin_offset(h, 0));
+    std::copy(x.begin(), x.end(), pts);
+    std::copy(y.begin(), y.end(), pts + x.size());
+
+    double* xf = reinterpret_cast<double*>(out.data() + bin_offset(h, 1));
+    double* yf = xf + N;
+    const size_t nblocks = (N + kGridRowsPerBlock - 1) / kGridRowsPerBlock;
+    parallel_for_tiles(nblocks, N, [&](size_t k) {
+        const size_t i0 = k * kGridRowsPerBlock, i1 = std::min(N, i0 + kGridRowsPerBlock);
+        eval_grid(md, coef, i0, i1, N, xmin, xmax, xf + i0, yf + i0);
+    });
+    out.close();
+}
+
+// -----------------------------
+// Workspace de DGELS reutilizable
+//
+// A, B y work se reservan una vez para hasta mmax filas (alineados, sin
+// rellenar con ceros); el tamaño óptimo de work se consulta una sola vez
+// (gels_lwork). Después cada solve() llama a gels (LAPACKE_dgels_work) sin
+// reservar memoria (LAPACKE_dgels reserva y libera work en cada llamada).
+//
+// Con nrhs > 1, B tiene nrhs columnas (m×nrhs, ldb = m): una sola QR de A
+// resuelve todas, y Q^T B y la sustitución con R son de nivel 3 (dlarfb,
+// dtrsm) en vez de nrhs factorizaciones.
+// -----------------------------
+class DgelsWorkspace {
+public:
+    void reserve(lapack_int mmax, lapack_int n, lapack_int nrhs = 1) {
+        mmax_ = std::max(mmax, n);
+        n_ = n;
+        nrhs_ = nrhs;
+        A_.resize(static_cast<size_t>(mmax_) * n);
+        B_.resize(static_cast<size_t>(mmax_) * nrhs);
+        sqrt_w_.resize(static_cast<size_t>(mmax_));
+        work_.resize(static_cast<size_t>(gels_lwork(mmax_, n_, nrhs_)));
+    }
+
+    // A (m×n, lda = m) y B (m×nrhs, ldb = m) se cargan en a() y b() antes de solve(m)
+    double* a() { return A_.data(); }
+    double* b() { return B_.data(); }
+    lapack_int rows() const { return mmax_; }
+    lapack_int nrhs() const { return nrhs_; }
+
+    // Carga A0 (m×n, lda = m) e y con cada fila escalada por √w_i (w == nullptr
+    // => sin pesos). A0 no se toca, así que se puede recargar en cada iteración
+    void load(const double* A0, const double* y, const double* w, lapack_int m) {
+        const size_t mm = static_cast<size_t>(m);
+        if (!w) {
+            std::copy(A0, A0 + mm * n_, A_.data());
+            std::copy(y, y + mm, B_.data());
+            return;
+        }
+        for (size_t i = 0; i < mm; ++i) {
+            sqrt_w_[i] = std::sqrt(w[i]);
+            B_[i] = y[i] * sqrt_w_[i];
+        }
+        for (lapack_int j = 0; j < n_; ++j) {
+            const double* src = A0 + static_cast<size_t>(j) * mm;
+            double* dst = A_.data() + static_cast<size_t>(j) * mm;
+            for (size_t i = 0; i < mm; ++i) dst[i] = src[i] * sqrt_w_[i];
+        }
+    }
+
+    // Tras resolver, cada columna j de B tiene la solución en las filas
+    // [0..n) y los residuos rotados en [n..m): b()[j*m ..]
+    lapack_int solve(lapack_int m) {
+        return gels(Matrix<double>(A_.data(), m, n_), Matrix<double>(B_.data(), m, nrhs_), work_.data(),
+                    static_cast<lapack_int>(work_.size()));
+    }
+
+    // SSE = ||B[n..m)||^2: Q es ortogonal, así que la norma de los residuos
+    // rotados Q^T (y - A θ) es la del residuo, sin volver a evaluar el modelo
+    double residual_ss(lapack_int m, lapack_int col = 0) const {
+        const double* bj = B_.data() + static_cast<size_t>(col) * m;
+        double sse = 0.0;
+        for (lapack_int i = n_; i < m; ++i) sse += bj[i] * bj[i];
+        return sse;
+    }
+
+private:
+    lapack_int mmax_ = 0, n_ = 0, nrhs_ = 1;
+    AlignedBuffer<double> A_, B_, work_, sqrt_w_;
+};
+
+// -----------------------------
+// Caché de la QR (--cache DIR)
+//
+// La clave es el hash de A tal como quedó cargada en el workspace (con las
+// filas ya escaladas por √w si hay pesos). Si no está, se factoriza con
+// dgeqrf en el workspace y se guarda (A con R y los reflectores, más tau);
+// si está, se usa la QR mapeada sin copiarla. En los dos casos se termina
+// como DGELS: B <- Q^T B (dormqr) y R θ = B(0..n) (dtrtrs), con todas las
+// columnas de B, así que b() y residual_ss() quedan igual que tras solve().
+// -----------------------------
+struct CacheUse {
+    bool hit = false;
+    std::string path;
+};
+
+static CacheUse solve_with_cache(DgelsWorkspace& ws, lapack_int m, lapack_int n, const FactorCache& cache) {
+    const uint64_t key = hash_matrix(Matrix<const double>(ws.a(), m, n));
+    CacheUse use;
+    CacheEntry entry;
+    std::vector<double> tau_buf;
+    const double* qr = ws.a();
+    const double* tau = nullptr;
+    use.hit = cache.load(FactorKind::qr, key, m, n, 0, entry);
+    if (use.hit) {
+        qr = entry.array<double>(0, static_cast<size_t>(m) * n);
+        tau = entry.array<double>(1, static_cast<size_t>(n));
+        use.path = entry.path();
+    } else {
+        tau_buf.resize(static_cast<size_t>(n));
+        lapack_check(geqrf(Matrix<double>(ws.a(), m, n), tau_buf.data()), "LAPACKE_dgeqrf");
+        tau = tau_buf.data();
+        use.path = cache.store(FactorKind::qr, key, m, n, 0,
+                               {CacheArray(ws.a(), static_cast<size_t>(m) * n), CacheArray(tau, static_cast<size_t>(n))});
+    }
+    const Matrix<const double> QR(qr, m, n);
+    const Matrix<double> B(ws.b(), m, ws.nrhs());
+    lapack_check(ormqr('T', QR, tau, B), "LAPACKE_dormqr");
+    lapack_check(trtrs('U', 'N', QR.block(0, 0, n, n), B.block(0, 0, n, ws.nrhs())), "LAPACKE_dtrtrs",
+                 "R singular: A no tiene rango completo");
+    return use;
+}
+
+// -----------------------------
+// Mínimos cuadrados ponderados y robustos (IRLS)
+//
+// min Σ w_i (y_i - φ(x_i)^T θ)^2 es un LS ordinario con cada fila de A y de y
+// escalada por √w_i: cada iteración recarga el mismo DgelsWorkspace desde
+// la A sin ponderar (A0), sin reservar memoria.
+//
+// Con --robust los pesos salen de los residuos estandarizados (r_i √w0_i si
+// hay pesos base w0 de --weights), u_i = r_i / σ con σ = mediana(|r|) / 0.6745:
+//   huber: w = 1 si |u| <= 1.345, si no 1.345 / |u|
+//   tukey: w = (1 - (u / 4.685)^2)^2 si |u| < 4.685, si no 0
+// multiplicados por los pesos de --weights si los hay. La primera iteración
+// parte de la solución ya calculada y se para cuando los coeficientes cambian
+// menos que kIrlsTol (relativo) o al llegar a --max-iter soluciones QR.
+// -----------------------------
+enum class Robust { none, huber, tukey };
+
+inline constexpr double kHuberK = 1.345;
+inline constexpr double kTukeyC = 4.685;
+inline constexpr double kIrlsTol = 1e-8;
+
+struct IrlsResult {
+    int solves = 1; // soluciones QR, contando la inicial
+    bool converged = false;
+    double sigma = 0.0;
+};
+
+// r = y - A0 θ con un solo dgemv
+static void residuals(const std::vector<double>& A0, lapack_int m, lapack_int n, const std::vector<double>& y,
+                      const std::vector<double>& theta, std::vector<double>& r) {
+    std::copy(y.begin(), y.end(), r.begin());
+    cblas_dgemv(CblasColMajor, CblasNoTrans, m, n, -1.0, A0.data(), m, theta.data(), 1, 1.0, r.data(), 1);
+}
+
+// coef entra con la solución inicial y sale con la robusta; w sale con los
+// pesos de la última solución
+static IrlsResult irls(DgelsWorkspace& ws, const std::vector<double>& A0, const std::vector<double>& y,
+                       const std::vector<double>& w0, Robust kind, int max_iter,
+                       std::vector<double>& coef, std::vector<double>& w) {
+    const lapack_int m = static_cast<lapack_int>(y.size());
+    const lapack_int n = static_cast<lapack_int>(coef.size());
+    std::vector<double> r(y.size()), abs_r(y.size());
+    IrlsResult res;
+
+    while (res.solves < max_iter) {
+        residuals(A0, m, n, y, coef, r);
+        for (size_t i = 0; i < r.size(); ++i) {
+            if (!w0.empty()) r[i] *= std::sqrt(w0[i]);
+            abs_r[i] = std::abs(r[i]);
+        }
+        const auto mid = abs_r.begin() + static_cast<std::ptrdiff_t>(abs_r.size() / 2);
+        std::nth_element(abs_r.begin(), mid, abs_r.end());
+        res.sigma = *mid / 0.6745;
+        if (!(res.sigma > 0.0)) { // la mitad de los puntos ya se ajusta exactamente
+            res.converged = true;
+            break;
+        }
+
+        for (size_t i = 0; i < r.size(); ++i) {
+            const double u = std::abs(r[i]) / res.sigma;
+            double wi = 0.0;
+            if (kind == Robust::huber) {
+                wi = (u <= kHuberK) ? 1.0 : kHuberK / u;
+            } else if (u < kTukeyC) {
+                const double t = 1.0 - (u / kTukeyC) * (u / kTukeyC);
+                wi = t * t;
+            }
+            w[i] = w0.empty() ? wi : w0[i] * wi;
+        }
+
+        ws.load(A0.data(), y.data(), w.data(), m);
+        lapack_check(ws.solve(m), "IRLS", "la matriz ponderada perdió rango (demasiados pesos nulos)");
+        ++res.solves;
+
+        double delta = 0.0, size = 0.0;
+        for (lapack_int j = 0; j < n; ++j) {
+            delta = std::max(delta, std::abs(ws.b()[j] - coef[static_cast<size_t>(j)]));
+            size = std::max(size, std::abs(ws.b()[j]));
+            coef[static_cast<size_t>(j)] = ws.b()[j];
+        }
+        if (delta <= kIrlsTol * (size + kIrlsTol)) {
+            res.converged = true;
+            break;
+        }
+    }
+    return res;
+}
+
+// Nombres de los coeficientes para los CSV: a,b,c (parábola) o c_d..c_0
+static std::vector<std::string> coef_names(const Model& md) {
+    if (md.basis == Basis::poly && md.degree == 2) return {"a", "b", "c"};
+    std::vector<std::string> names;
+    for (int k = md.degree; k >= 0; --k) names.push_back(std::string(1, 'c').append(std::to_string(k)));
+    return names;
+}
+
+// -----------------------------
+// Modo --batch: un polinomio (base monomial) por serie
+//
+// Cada hilo copia un DgelsWorkspace dimensionado para la serie más larga,
+// así que ningún ajuste reserva memoria.
+// -----------------------------
+static void run_batch_fits(const std::string& in_path, const std::string& out_path, const Model& md) {
+    SeriesTable t;
+    load_series(in_path, t);
+    const lapack_int n = md.params();
+
+    DgelsWorkspace proto;
+    proto.reserve(static_cast<lapack_int>(t.max_len), n);
+
+    const size_t np = static_cast<size_t>(n) + 1; // coeficientes + sse
+    std::vector<double> results(t.count() * np);
+    parallel_series(t.count(), proto, [&](size_t s, DgelsWorkspace& w) {
+        double* r = results.data() + s * np;
+        std::fill(r, r + np, std::numeric_limits<double>::quiet_NaN());
+        const lapack_int m = static_cast<lapack_int>(t.length(s));
+        if (m < n) return;
+        fill_design(md, t.x.data() + t.offsets[s], m, w.a(), m);
+        std::copy(t.y.data() + t.offsets[s], t.y.data() + t.offsets[s] + m, w.b());
+        if (w.solve(m) != 0) return; // A sin rango completo (p. ej. menos de n x distintos)
+        std::copy(w.b(), w.b() + n, r);
+        r[n] = w.residual_ss(m);
+    });
+
+    write_fit_results(out_path, t, coef_names(md), results);
+    std::cout << "OK: " << t.count() << " polinomios de grado " << md.degree << " ajustados -> " << out_path << "\n";
+}
+
+// -----------------------------
+// Modo --multi: k respuestas sobre la misma x
+//
+// La matriz de diseño es la misma para todas, así que se resuelven juntas:
+// una QR de A y B = [y_1 ... y_k] con nrhs = k (ver DgelsWorkspace). Con
+// --cache, la QR se guarda o se toma de la caché como en el ajuste simple.
+// -----------------------------
+// Resuelve las k columnas de Y (m×k column-major) sobre x en ws; al volver,
+// la columna j de ws.b() tiene los coeficientes y ws.residual_ss(m, j) su SSE
+static CacheUse solve_responses(Model md, const double* x, const double* Y, lapack_int m, lapack_int k,
+                                DgelsWorkspace& ws, const FactorCache& cache) {
+    const lapack_int n = md.params();
+    if (m < n) throw std::runtime_error("Se necesitan al menos " + std::to_string(n) + " puntos.");
+    if (md.basis == Basis::cheb) {
+        const auto [lo, hi] = std::minmax_element(x, x + m);
+        if (!(*hi > *lo)) throw std::runtime_error("--basis cheb requiere al menos dos x distintos.");
+        md.lo = *lo;
+        md.hi = *hi;
+    }
+
+    ws.reserve(m, n, k);
+    fill_design(md, x, m, ws.a(), m);
+    std::copy(Y, Y + static_cast<size_t>(m) * k, ws.b());
+    CacheUse use;
+    if (cache.enabled()) use = solve_with_cache(ws, m, n, cache);
+    else lapack_check(ws.solve(m), "LAPACKE_dgels");
+    return use;
+}
+
+static void run_multi_fits(const std::string& in_path, const std::string& out_path, const Model& md,
+                           const FactorCache& cache) {
+    ResponseTable t;
+    read_responses(in_path, t);
+    const lapack_int m = static_cast<lapack_int>(t.rows());
+    const lapack_int n = md.params();
+    const lapack_int k = static_cast<lapack_int>(t.count());
+
+    DgelsWorkspace ws;
+    const CacheUse cache_use = solve_responses(md, t.x.data(), t.Y.data(), m, k, ws, cache);
+
+    const size_t np = static_cast<size_t>(n) + 1; // coeficientes + sse
+    std::vector<double> results(t.count() * np);
+    for (lapack_int j = 0; j < k; ++j) {
+        const double* bj = ws.b() + static_cast<size_t>(j) * m;
+        std::copy(bj, bj + n, results.data() + j * np);
+        results[j * np + n] = ws.residual_ss(m, j);
+    }
+
+    write_response_results(out_path, t, coef_names(md), results);
+    std::cout << "OK: " << k << " respuestas sobre " << m << " puntos, grado " << md.degree
+              << " (una QR, nrhs = " << k << ") -> " << out_path << "\n";
+    if (cache.enabled())
+        std::cout << "Cache QR: " << (cache_use.hit ? "reutilizada de " : "guardada en ") << cache_use.path << "\n";
+}
+
+// -----------------------------
+// Modo --serve: trabajos kJobFit (x, Y -> coeficientes, sse)
+//
+// Igual que --multi, con x e Y desde el payload. param >= 0 fija el grado
+// (si no, el de --degree); la base es la de --basis. El workspace de dgels
+// vive entre trabajos y solo se agranda, y con --cache la misma x reutiliza
+// su QR. Respuesta: coeficientes (n×k) y sse (1×k), column-major.
+// -----------------------------
+static void run_server(const std::string& addr, const Model& base, const FactorCache& cache) {
+    DgelsWorkspace ws;
+    AlignedBuffer<double> Ybuf;
+    serve(addr, [&](const JobFrame& req, const JobInput& in, JobOutput& out) {
+        if (req.op != kJobFit) throw unsupported_job(req);
+        Model md = base;
+        if (req.param >= 0) {
+            if (req.param > 30) throw std::runtime_error("El grado debe ser un entero entre 0 y 30.");
+            md.degree = req.param;
+        }
+        const FitJob job = read_fit_job(in, Ybuf);
+        const lapack_int n = md.params();
+        solve_responses(md, job.x, job.Y, job.m, job.k, ws, cache);
+
+        out.shape(kDtypeF64, kLayoutCol, {{n, job.k}, {1, job.k}});
+        double* coef = out.matrix<double>(0);
+        double* sse = out.matrix<double>(1);
+        for (lapack_int j = 0; j < job.k; ++j) {
+            const double* bj = ws.b() + static_cast<size_t>(j) * job.m;
+            std::copy(bj, bj + n, coef + static_cast<size_t>(j) * n);
+            sse[j] = ws.residual_ss(job.m, j);
+        }
+    });
+}
+
+// -----------------------------
+// Modo --online: R se actualiza con cada muestra nueva (O(n²) por muestra)
+//
+// Con --data, el estado se siembra con el QR de DGELS sobre esos puntos (R
+// queda en el triángulo superior de A); si no, parte vacío. Cada
+// --report-every muestras se imprime "count,coeficientes...,sse".
+// -----------------------------
+static void run_online(Model md, const std::string& seed_path, const std::string& src, double forget,
+                       long long report_every) {
+    const lapack_int n = md.params();
+    OnlineLS ls(n, forget);
+    if (md.basis == Basis::cheb && seed_path.empty())
+        throw std::runtime_error("--online con --basis cheb requiere --data (fija el intervalo de x).");
+
+    if (!seed_path.empty()) {
+        std::vector<double> x, y;
+        read_points(seed_path, x, y);
+        const lapack_int m = static_cast<lapack_int>(x.size());
+        if (m < n) throw std::runtime_error("Se necesitan al menos " + std::to_string(n) + " puntos en --data.");
+        if (md.basis == Basis::cheb) {
+            const auto [lo, hi] = std::minmax_element(x.begin(), x.end());
+            if (!(*hi > *lo)) throw std::runtime_error("--basis cheb requiere al menos dos x distintos.");
+            md.lo = *lo;
+            md.hi = *hi;
+        }
+        DgelsWorkspace ws;
+        ws.reserve(m, n);
+        fill_design(md, x.data(), m, ws.a(), m);
+        std::copy(y.begin(), y.end(), ws.b());
+        lapack_check(ws.solve(m), "LAPACKE_dgels", "fallo al sembrar --online");
+        ls.seed(ws.a(), m, ws.b(), ws.residual_ss(m), m);
+    }
+
+    std::string header = "count";
+    for (const auto& name : coef_names(md)) header += "," + name;
+    std::cout << header << ",sse\n";
+
+    std::vector<double> phi(static_cast<size_t>(n)), theta(static_cast<size_t>(n));
+    long long seen = 0;
+    auto on_sample = [&](double xi, double yi) {
+        fill_design(md, &xi, 1, phi.data(), 1); // fila φ(x)^T
+        ls.add(phi.data(), yi);
+        if (++seen % report_every == 0) print_online_state(std::cout, ls, theta);
+    };
+    if (src == "-") {
+        for_each_sample(std::cin, on_sample);
+    } else {
+        std::ifstream fin(src);
+        if (!fin) throw std::runtime_error("No se pudo abrir el archivo de muestras: " + src);
+        for_each_sample(fin, on_sample);
+    }
+    if (seen % report_every != 0 || seen == 0) print_online_state(std::cout, ls, theta);
+}
+
+int main(int argc, char** argv) {
     try {
+        Model md;
+        std::string data_path, batch_in, batch_out;
+        std::string multi_in, multi_out; // --multi: k respuestas, una sola QR
+        size_t grid = 200;         // puntos de la curva ajustada
+        bool fit_bin = false;      // --fit-format bin
+        std::string fit_out;       // "" => fit.csv / fit.bin
+        int points = -1;           // tabla por punto: -1 => solo con los datos de la imagen
+        std::string online_src;    // --online: muestras nuevas ("-" => stdin)
+        double forget = 1.0;       // factor de olvido λ (1 => sin olvido)
+        long long report_every = 1;
+        bool use_weights = false;  // --weights: tercera columna de --data
+        Robust robust = Robust::none;
+        int max_iter = 50;         // tope de soluciones QR del IRLS
+        std::string cache_dir;     // --cache: directorio de la caché de QR
+        std::string serve_addr;    // --serve: unix:RUTA o tcp:HOST:PUERTO
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg = argv[i];
+            if (arg == "--degree" && i + 1 < argc) {
+                md.degree = std::atoi(argv[++i]);
+                if (md.degree < 0 || md.degree > 30)
+                    throw std::runtime_error("--degree debe ser un entero entre 0 y 30.");
+            } else if (arg == "--basis" && i + 1 < argc) {
+                const std::string v = argv[++i];
+                if (v == "poly") md.basis = Basis::poly;
+                else if (v == "cheb") md.basis = Basis::cheb;
+                else throw std::runtime_error("--basis debe ser poly o cheb.");
+            } else if (arg == "--grid" && i + 1 < argc) {
+                const long long g = std::atoll(argv[++i]);
+                if (g < 2) throw std::runtime_error("--grid debe ser un entero >= 2.");
+                grid = static_cast<size_t>(g);
+            } else if (arg == "--fit-format" && i + 1 < argc) {
+                const std::string v = argv[++i];
+                if (v != "csv" && v != "bin") throw std::runtime_error("--fit-format debe ser csv o bin.");
+                fit_bin = (v == "bin");
+            } else if (arg == "--fit-out" && i + 1 < argc) {
+                fit_out = argv[++i];
+            } else if (arg == "--points" || arg == "--no-points") {
+                points = (arg == "--points") ? 1 : 0;
+            } else if (arg == "--online" && i + 1 < argc) {
+                online_src = argv[++i];
+            } else if (arg == "--forget" && i + 1 < argc) {
+                forget = std::atof(argv[++i]);
+                if (!(forget > 0.0 && forget <= 1.0)) throw std::runtime_error("--forget debe estar en (0, 1].");
+            } else if (arg == "--report-every" && i + 1 < argc) {
+                report_every = std::atoll(argv[++i]);
+                if (report_every <= 0) throw std::runtime_error("--report-every debe ser un entero positivo.");
+            } else if (arg == "--weights") {
+                use_weights = true;
+            } else if (arg == "--robust" && i + 1 < argc) {
+                const std::string v = argv[++i];
+                if (v == "huber") robust = Robust::huber;
+                else if (v == "tukey") robust = Robust::tukey;
+                else throw std::runtime_error("--robust debe ser huber o tukey.");
+            } else if (arg == "--max-iter" && i + 1 < argc) {
+                max_iter = std::atoi(argv[++i]);
+                if (max_iter < 1) throw std::runtime_error("--max-iter debe ser un entero positivo.");
+            } else if (arg == "--cache" && i + 1 < argc) {
+                cache_dir = argv[++i];
+            } else if (runtime_option(argc, argv, i) || serve_option(argc, argv, i)) {
+            } else if (arg == "--data" && i + 1 < argc) {
+                data_path = argv[++i];
+            } else if (arg == "--batch" && i + 2 < argc) {
+                batch_in = argv[++i];
+                batch_out = argv[++i];
+            } else if (arg == "--multi" && i + 2 < argc) {
+                multi_in = argv[++i];
+                multi_out = argv[++i];
+            } else if (arg == "--serve" && i + 1 < argc) {
+                serve_addr = argv[++i];
+            } else {
+                std::cerr << "Uso: " << argv[0] << " [--degree d] [--basis poly|cheb] [--data <puntos.txt>]\n"
+                          << "         [--grid N] [--fit-format csv|bin] [--fit-out <archivo>] [--points|--no-points]\n"
+                          << "         [--weights] [--robust huber|tukey] [--max-iter N] [--cache <dir>]\n"
+                          << "     " << argv[0] << " [--degree d] --batch <series.csv> <ajustes.csv>\n"
+                          << "     " << argv[0] << " [--degree d] [--basis poly|cheb] --multi <respuestas.csv> <ajustes.csv>"
+                             " [--cache <dir>]\n"
+                          << "     " << argv[0] << " [--degree d] [--data <iniciales.txt>] --online <nuevas.txt|->"
+                             " [--forget λ] [--report-every K]\n"
+                          << "     " << argv[0] << " [--degree d] [--basis poly|cheb] [--cache <dir>] --serve unix:RUTA|tcp:HOST:PUERTO [--max-payload MiB]\n"
+                          << "  (todos los modos) " << kRuntimeUsage << "\n";
+                return 1;
+            }
+        }
+        apply_runtime();
+
+        if (use_weights && data_path.empty()) throw std::runtime_error("--weights requiere --data (puntos x,y,w).");
+        if ((use_weights || robust != Robust::none) && (!batch_in.empty() || !online_src.empty() || !multi_in.empty()))
+            throw std::runtime_error("--weights y --robust no se combinan con --batch, --multi ni --online.");
+        if (!cache_dir.empty() && (!batch_in.empty() || !online_src.empty()))
+            throw std::runtime_error("--cache no se combina con --batch ni --online.");
+
+        if (!serve_addr.empty()) {
+            if (!multi_in.empty() || !batch_in.empty() || !online_src.empty() || !data_path.empty())
+                throw std::runtime_error("--serve no se combina con --data, --batch, --multi ni --online.");
+            run_server(serve_addr, md, FactorCache(cache_dir));
+            return 0;
+        }
+        if (serve_config().max_payload_set) throw std::runtime_error("--max-payload requiere --serve.");
+
+        if (!multi_in.empty()) {
+            run_multi_fits(multi_in, multi_out, md, FactorCache(cache_dir));
+            return 0;
+        }
+
+        if (!batch_in.empty()) {
+            if (md.basis != Basis::poly) throw std::runtime_error("--batch solo admite --basis poly.");
+            run_batch_fits(batch_in, batch_out, md);
+            return 0;
+        }
+
+        if (!online_src.empty()) {
+            run_online(md, data_path, online_src, forget, report_every);
+            return 0;
+        }
+
         // -----------------------------
         // 1) Datos
         // -----------------------------
-        const std::vector<double> x = {0, 1, 2, 3, 4, 5};
-        const std::vector<double> y = {1.2, 2.0, 2.9, 4.1, 5.8, 8.2};
+        std::vector<double> x = {0, 1, 2, 3, 4, 5};
+        std::vector<double> y = {1.2, 2.0, 2.9, 4.1, 5.8, 8.2};
+        std::vector<double> w0; // pesos de --weights (vacío => todos 1)
+        if (!data_path.empty()) read_points(data_path, x, y, use_weights ? &w0 : nullptr);
 
         const lapack_int m = static_cast<lapack_int>(x.size()); // # muestras
-        const lapack_int n = 3;                                 // parámetros: a,b,c
-        const lapack_int nrhs = 1;                              // una columna (y)
+        const lapack_int n = md.params();                       // parámetros: c_d..c_0
+        if (m < n) throw std::runtime_error("Se necesitan al menos " + std::to_string(n) + " puntos.");
+
+        const auto [xmin_it, xmax_it] = std::minmax_element(x.begin(), x.end());
+        const double xmin = *xmin_it;
+        const double xmax = *xmax_it;
+        if (md.basis == Basis::cheb) {
+            if (!(xmax > xmin)) throw std::runtime_error("--basis cheb requiere al menos dos x distintos.");
+            md.lo = xmin;
+            md.hi = xmax;
+        }
 
         // -----------------------------
         // 2) Construir matriz de diseño A (m×n)
         //    Para cada fila i:
-        //      [ x_i^2,  x_i,  1 ]
+        //      [ x_i^d, ..., x_i,  1 ]   (con d = 2: [ x_i^2,  x_i,  1 ])
         //
         // LAPACKE_dgels espera A en COLUMN-MAJOR:
         //   A(j*m + i) = A(i,j)
-        // -----------------------------
-        std::vector<double> A(static_cast<size_t>(m) * n);
-        for (lapack_int i = 0; i < m; ++i) {
-            const double xi = x[static_cast<size_t>(i)];
-            A[0 * m + i] = xi * xi; // columna 0: x^2
-            A[1 * m + i] = xi;      // columna 1: x
-            A[2 * m + i] = 1.0;     // columna 2: 1
-        }
-
-        // -----------------------------
+        //
         // 3) Vector B para dgels (sobrescrito con la solución)
         //
         // DGELS resuelve min ||A*X - B||_2. Para el caso sobredeterminado (m>=n):
@@ -66,70 +770,111 @@ int main() {
         // - Tras resolver, las primeras n entradas de B contienen X = [a,b,c].
         // - El resto de B (desde n hasta m-1) contiene residuos en forma compacta.
         // -----------------------------
-        const lapack_int ldb = std::max(m, n);
-        std::vector<double> B(static_cast<size_t>(ldb) * nrhs, 0.0);
-        for (lapack_int i = 0; i < m; ++i) {
-            B[static_cast<size_t>(i)] = y[static_cast<size_t>(i)];
-        }
+        DgelsWorkspace ws;
+        ws.reserve(m, n);
+        fill_design(md, x.data(), m, ws.a(), m);
+        std::copy(y.begin(), y.end(), ws.b());
+
+        // DGELS sobrescribe A con su factorización QR: si hay que imprimir
+        // predicciones o ponderar filas, guardamos una copia sin ponderar (A0)
+        const bool show_points = (points < 0) ? data_path.empty() : (points == 1);
+        const bool weighted = !w0.empty() || robust != Robust::none;
+        std::vector<double> A0;
+        if (show_points || weighted) A0.assign(ws.a(), ws.a() + static_cast<size_t>(m) * n);
+        if (!w0.empty()) ws.load(A0.data(), y.data(), w0.data(), m);
 
         // -----------------------------
         // 4) Resolver con DGELS (QR)
         //    trans='N' => usa A tal cual.
+        //    Con --cache, la misma QR pero guardada o tomada de la caché.
+        //    Las iteraciones del IRLS cambian los pesos (y A): no se guardan.
         // -----------------------------
-        const char trans = 'N';
-        const lapack_int info = LAPACKE_dgels(
-            LAPACK_COL_MAJOR,
-            trans,
-            m, n, nrhs,
-            A.data(), m,  // lda = m (column-major)
-            B.data(), ldb // ldb = max(m,n)
-        );
-
-        if (info < 0) {
-            throw std::runtime_error("LAPACKE_dgels: argumento ilegal en posicion " + std::to_string(-info));
-        }
-        if (info > 0) {
-            throw std::runtime_error("LAPACKE_dgels: fallo numérico (info=" + std::to_string(info) + ")");
-        }
+        const FactorCache cache(cache_dir);
+        CacheUse cache_use;
+        if (cache.enabled()) cache_use = solve_with_cache(ws, m, n, cache);
+        else lapack_check(ws.solve(m), "LAPACKE_dgels");
 
         // Coeficientes (solución) en B[0..n-1]
-        const double a = B[0];
-        const double b = B[1];
-        const double c = B[2];
+        std::vector<double> coef(ws.b(), ws.b() + n);
+
+        // IRLS: repesa y vuelve a resolver partiendo de coef
+        std::vector<double> w = w0;
+        IrlsResult irls_res;
+        if (robust != Robust::none) {
+            w.resize(static_cast<size_t>(m), 1.0);
+            irls_res = irls(ws, A0, y, w0, robust, max_iter, coef, w);
+        }
 
         // -----------------------------
         // 5) Reporte: modelo y calidad del ajuste
         // -----------------------------
         std::cout << std::fixed << std::setprecision(10);
-        std::cout << "Modelo cuadratico (minimos cuadrados con DGELS/QR):\n";
-        std::cout << "y = a*x^2 + b*x + c\n";
-        std::cout << "a = " << a << "\n";
-        std::cout << "b = " << b << "\n";
-        std::cout << "c = " << c << "\n\n";
+        if (md.basis == Basis::poly && md.degree == 2) {
+            std::cout << "Modelo cuadratico (minimos cuadrados con DGELS/QR):\n";
+            std::cout << "y = a*x^2 + b*x + c\n";
+            std::cout << "a = " << coef[0] << "\n";
+            std::cout << "b = " << coef[1] << "\n";
+            std::cout << "c = " << coef[2] << "\n\n";
+        } else {
+            const char* phi = md.basis == Basis::poly ? "x^" : "T_";
+            std::cout << "Modelo de grado " << md.degree << " (minimos cuadrados con DGELS/QR):\n";
+            std::cout << "y = sum_k c_k*" << phi << "k";
+            if (md.basis == Basis::cheb)
+                std::cout << "(t),  t = (2x - (" << md.lo << " + " << md.hi << ")) / (" << md.hi << " - " << md.lo << ")";
+            std::cout << "\n";
+            for (lapack_int j = 0; j < n; ++j) std::cout << "c_" << (md.degree - j) << " = " << coef[j] << "\n";
+            std::cout << "\n";
+        }
 
-        double sse = 0.0;
-        std::cout << "Puntos y prediccion:\n";
-        for (size_t i = 0; i < x.size(); ++i) {
-            const double xi = x[i];
-            const double y_hat = a * xi * xi + b * xi + c;
-            const double err = y_hat - y[i];
-            sse += err * err;
-
-            std::cout << "x=" << xi
-                      << "  y=" << y[i]
-                      << "  y_hat=" << y_hat
-                      << "  err=" << err << "\n";
+        // Sin pesos, el SSE sale de los residuos rotados de DGELS; con pesos eso
+        // es Σ w r², así que el SSE sin ponderar se toma de r = y - A0 θ
+        std::vector<double> r;
+        double sse = ws.residual_ss(m);
+        if (weighted) {
+            r.resize(static_cast<size_t>(m));
+            residuals(A0, m, n, y, coef, r);
+            sse = 0.0;
+            for (double ri : r) sse += ri * ri;
         }
+        if (show_points) {
+            // y_hat = A * theta con un solo dgemv
+            std::vector<double> y_hat(static_cast<size_t>(m));
+            cblas_dgemv(CblasColMajor, CblasNoTrans, m, n, 1.0, A0.data(), m, coef.data(), 1, 0.0, y_hat.data(), 1);
+
+            std::cout << "Puntos y prediccion:\n";
+            for (size_t i = 0; i < x.size(); ++i) {
+                const double err = y_hat[i] - y[i];
+                std::cout << "x=" << x[i]
+                          << "  y=" << y[i]
+                          << "  y_hat=" << y_hat[i]
+                          << "  err=" << err;
+                if (weighted) std::cout << "  w=" << w[i];
+                std::cout << "\n";
+            }
+            std::cout << "\n";
+        } else {
+            std::cout << "Puntos: " << m << "\n";
+        }
+        if (robust != Robust::none) {
+            const long long rejected = std::count(w.begin(), w.end(), 0.0);
+            std::cout << "IRLS (" << (robust == Robust::huber ? "huber" : "tukey") << "): " << irls_res.solves
+                      << " soluciones QR, " << (irls_res.converged ? "convergio" : "sin converger")
+                      << ", sigma = " << irls_res.sigma << ", pesos nulos = " << rejected << "\n";
+        }
+        if (weighted) std::cout << "SSE ponderado = " << ws.residual_ss(m) << "\n";
         const double mse = sse / static_cast<double>(m);
-        std::cout << "\nSSE = " << sse << "\n";
+        std::cout << "SSE = " << sse << "\n";
         std::cout << "MSE = " << mse << "\n";
+        if (cache.enabled())
+            std::cout << "Cache QR: " << (cache_use.hit ? "reutilizada de " : "guardada en ") << cache_use.path << "\n";
 
         // -----------------------------
         // 6) Generar un CSV para graficar
         //
         // fit.csv contendrá:
         //   - puntos originales (x, y)
-        //   - curva ajustada en una malla fina (x_fit, y_fit)
+        //   - curva ajustada en una malla fina de --grid puntos (x_fit, y_fit)
+        // (con --fit-format bin, un binario MCSM columnar: ver write_fit_bin)
         //
         // Esto te permite graficar fácil en Octave:
         //   data = csvread("fit.csv", 1, 0);
@@ -145,39 +890,19 @@ int main() {
         //   title("Ajuste cuadratico");
         //   legend("Datos", "Ajuste");
         // -----------------------------
-        {
-            std::ofstream out("fit.csv");
-            if (!out) throw std::runtime_error("No se pudo crear fit.csv");
-
-            // Encabezados (columnas)
-            out << "x_pts,y_pts,x_fit,y_fit\n";
-
-            // Malla fina para la curva
-            const int steps = 200;
-            const double xmin = x.front();
-            const double xmax = x.back();
-
-            for (int i = 0; i < steps; ++i) {
-                const double t = static_cast<double>(i) / (steps - 1);
-                const double xf = xmin + t * (xmax - xmin);
-                const double yf = a * xf * xf + b * xf + c;
-
-                // Para las filas donde haya punto real, lo escribimos; si no, dejamos vacío.
-                // (Se hace simple: escribimos puntos reales solo en las primeras x.size() filas)
-                if (i < static_cast<int>(x.size())) {
-                    out << x[static_cast<size_t>(i)] << "," << y[static_cast<size_t>(i)] << ",";
-                } else {
-                    out << ",,";
-                }
-                out << xf << "," << yf << "\n";
-            }
+        if (fit_out.empty()) fit_out = fit_bin ? "fit.bin" : "fit.csv";
+        if (fit_bin) {
+            write_fit_bin(fit_out, x, y, md, coef.data(), grid, xmin, xmax);
+            std::cout << "\nSe genero " << fit_out << " (binario MCSM: puntos m×2 y curva " << grid << "×2, column-major).\n";
+            return 0;
         }
+        write_fit_csv(fit_out, x, y, md, coef.data(), grid, xmin, xmax);
 
-        std::cout << "\nSe genero fit.csv para graficar (puntos y curva).\n";
+        std::cout << "\nSe genero " << fit_out << " para graficar (puntos y curva).\n";
 
         // Tip rápido de Octave en consola:
 		std::cout << "Octave (ejemplo):\n";
-		std::cout << "  data = csvread(\"fit.csv\", 1, 0);\n";
+		std::cout << "  data = csvread(\"" << fit_out << "\", 1, 0);\n";
 		std::cout << "  x_pts = data(:,1);\n";
         std::cout << "  y_pts = data(:,2);\n";
         std::cout << "  x_fit = data(:,3);\n";
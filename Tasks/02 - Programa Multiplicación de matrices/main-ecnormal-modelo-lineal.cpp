@@ -14,117 +14,675 @@
 //   (A^T A) θ = A^T y
 //
 // En este programa:
-// 1) Construimos A (m×n) y y (m×1)
-// 2) Calculamos ATA = A^T A y ATy = A^T y
-// 3) Resolvemos (ATA) θ = ATy con LAPACK: LAPACKE_dgesv
+// 1) Leemos los puntos por bloques (chunks) de filas
+// 2) Acumulamos ATA += A_k^T A_k (dsyrk) y ATy += A_k^T y_k (dgemv) por bloque
+// 3) Resolvemos (ATA) θ = ATy con LAPACK: Cholesky (LAPACKE_dposv), porque
+//    ATA es simétrica definida positiva; si no lo es, LU (LAPACKE_dgesv)
+//
+// A nunca se construye completa: solo un bloque de kChunkRows filas a la vez,
+// así que la memoria es O(n²) (más el bloque) sin importar cuántas muestras haya.
+//
+// Modo streaming (--data): registros "x y" (uno por línea, separados por
+// espacios o comas) desde un archivo o desde stdin con "-".
+//
+// Camino rápido (por defecto): para y = a x + b basta una pasada que sume
+// Σu, Σv, Σu², Σuv, Σv² (u = x - x0, v = y - y0, desplazados por el primer
+// punto para evitar cancelación) y resolver el sistema 2×2 en forma cerrada.
+// Con --general se usa el camino BLAS/LAPACK (dsyrk + dgemv + dposv).
 //
 // Compilar en MSYS2 UCRT64 (OpenBLAS + LAPACKE):
 //   g++ -std=c++23 -O2 -Wall -Wextra main-ecnormal-modelo-lineal.cpp -o app2.exe -llapacke -lopenblas
+//   (con --serve en Windows, agregar -lws2_32)
 //
 // Ejecutar:
-//   ./app2.exe
+//   ./app2.exe                      (datos de la imagen)
+//   ./app2.exe --data puntos.txt
+//   ./app2.exe --general --data puntos.txt (camino BLAS/LAPACK)
+//   ./app2.exe --general --data puntos.txt --cache cache/ (reutiliza Cholesky/LU de ATA)
+//   ./app2.exe --batch series.csv ajustes.csv (una recta por serie; ver batch_fit.hpp)
+//   ./app2.exe --multi respuestas.csv ajustes.csv (k respuestas "x,y_1..y_k": nrhs = k)
+//   ./app2.exe --serve tcp:127.0.0.1:5001 (servidor de ajustes; ver server.hpp)
+//   ./app2.exe --no-points          (omite la tabla por punto; con --data nunca se imprime)
+//   cat nuevas.txt | ./app2.exe --data iniciales.txt --online - --forget 0.99
+//                                   (actualiza R por muestra con Givens; ver online_ls.hpp)
+//
+// El SSE sale de las sumas acumuladas, sin reevaluar el modelo en cada punto.
+//   cat puntos.txt | ./app2.exe --data -
 
 #include <iostream>
 #include <iomanip>
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <string>
 #include <vector>
 #include <stdexcept>
 
-#include <lapacke.h>  // LAPACKE_dgesv
-#include "openblas/cblas.h"    // cblas_dgemm, cblas_dgemv
+#include "../../include/mcs/factor_cache.hpp" // FactorCache, hash_matrix
+#include "../../include/mcs/lapack.hpp"       // posv, gesv, potrs, getrs
+#include "../../include/mcs/runtime.hpp"      // --threads, --bind, --backend
+#include "openblas/cblas.h"    // cblas_dsyrk, cblas_dgemv
+
+#include "batch_fit.hpp"
+#include "online_ls.hpp"
+
+// -----------------------------
+// Acumulador de la ecuación normal
+//
+// Cada bloque A_k (rows×n, column-major) suma su contribución:
+//   ATA += A_k^T A_k  con dsyrk (solo el triángulo superior)
+//   ATy += A_k^T y_k  con dgemv
+//   yty += y_k^T y_k  (para el SSE sin volver a leer los datos)
+// Con nrhs > 1 respuestas (--multi), y_k es rows×nrhs: ATy (n×nrhs) se
+// acumula con un dgemm y yty guarda la suma de cuadrados de cada columna.
+//
+// Como en LinearSums, los datos se desplazan por la primera fila antes de
+// sumar: la última columna de A es la de unos (b) y no se toca; las demás
+// columnas y cada respuesta restan su primer valor. Sin esto, con y grande
+// (p. ej. y ≈ 1e8) y^T y y θ^T A^T y casi se cancelan y el SSE sale 0.
+// coefficients() devuelve θ en las variables originales.
+// -----------------------------
+static constexpr int kChunkRows = 65536;       // filas por bloque
+static constexpr size_t kReadBytes = size_t{1} << 20;
+
+struct NormalEquations {
+    int n, nrhs;
+    std::vector<double> ATA; // n×n column-major (triángulo superior)
+    std::vector<double> ATy; // n×nrhs column-major
+    std::vector<double> yty; // nrhs
+    std::vector<double> x0;  // desplazamiento de cada columna de A (0 en la de unos)
+    std::vector<double> y0;  // desplazamiento de cada respuesta
+    long long count = 0;
+
+    explicit NormalEquations(int n_, int nrhs_ = 1)
+        : n(n_), nrhs(nrhs_), ATA(static_cast<size_t>(n_) * n_, 0.0), ATy(static_cast<size_t>(n_) * nrhs_, 0.0),
+          yty(nrhs_, 0.0), x0(n_, 0.0), y0(nrhs_, 0.0) {}
+
+    // y: rows×nrhs con leading dimension ldy (0 => rows)
+    void add_chunk(const double* A, const double* y, int rows, int ldy = 0) {
+        if (rows == 0) return;
+        if (ldy == 0) ldy = rows;
+        if (count == 0) {
+            for (int c = 0; c + 1 < n; ++c) x0[c] = A[static_cast<size_t>(c) * rows];
+            for (int j = 0; j < nrhs; ++j) y0[j] = y[static_cast<size_t>(j) * ldy];
+        }
+        // Bloque desplazado: Ac = A - x0 (rows×n), yc = y - y0 (rows×nrhs, ld = rows)
+        Ac.resize(static_cast<size_t>(rows) * n);
+        yc.resize(static_cast<size_t>(rows) * nrhs);
+        for (int c = 0; c < n; ++c) {
+            const double* a = A + static_cast<size_t>(c) * rows;
+            double* ac = Ac.data() + static_cast<size_t>(c) * rows;
+            for (int i = 0; i < rows; ++i) ac[i] = a[i] - x0[c];
+        }
+        for (int j = 0; j < nrhs; ++j) {
+            const double* yj = y + static_cast<size_t>(j) * ldy;
+            double* ycj = yc.data() + static_cast<size_t>(j) * rows;
+            for (int i = 0; i < rows; ++i) ycj[i] = yj[i] - y0[j];
+        }
+        // ATA = 1.0 * A^T A + 1.0 * ATA
+        cblas_dsyrk(CblasColMajor, CblasUpper, CblasTrans,
+                    n, rows, 1.0, Ac.data(), rows, 1.0, ATA.data(), n);
+        // ATy = 1.0 * A^T y + 1.0 * ATy
+        if (nrhs == 1)
+            cblas_dgemv(CblasColMajor, CblasTrans, rows, n, 1.0, Ac.data(), rows, yc.data(), 1, 1.0, ATy.data(), 1);
+        else
+            cblas_dgemm(CblasColMajor, CblasTrans, CblasNoTrans, n, nrhs, rows, 1.0, Ac.data(), rows, yc.data(),
+                        rows, 1.0, ATy.data(), n);
+        for (int j = 0; j < nrhs; ++j) {
+            const double* ycj = yc.data() + static_cast<size_t>(j) * rows;
+            yty[j] += cblas_ddot(rows, ycj, 1, ycj, 1);
+        }
+        count += rows;
+    }
+
+    // SSE de la respuesta j con θ_j (columna j de theta, n×nrhs, la solución
+    // de las sumas desplazadas): y^T y - 2 θ^T A^T y + θ^T (A^T A) θ; en la
+    // solución de la ecuación normal se reduce a y^T y - θ^T A^T y
+    double sse(const std::vector<double>& theta, int j) const {
+        const size_t off = static_cast<size_t>(j) * n;
+        return std::max(0.0, yty[j] - cblas_ddot(n, theta.data() + off, 1, ATy.data() + off, 1));
+    }
+
+    // θ en las variables originales: las pendientes no cambian; el término
+    // independiente (última fila) recupera y0 - Σ θ_c x0_c
+    std::vector<double> coefficients(const std::vector<double>& theta) const {
+        std::vector<double> out = theta;
+        for (int j = 0; j < nrhs; ++j) {
+            double* t = out.data() + static_cast<size_t>(j) * n;
+            double shift = y0[j];
+            for (int c = 0; c + 1 < n; ++c) shift -= t[c] * x0[c];
+            t[n - 1] += shift;
+        }
+        return out;
+    }
+
+    // dgesv (respaldo de dposv) necesita la matriz completa:
+    // copiamos el triángulo superior al inferior
+    std::vector<double> full_ATA() const {
+        std::vector<double> M = ATA;
+        for (int j = 0; j < n; ++j)
+            for (int i = j + 1; i < n; ++i) M[static_cast<size_t>(j) * n + i] = M[static_cast<size_t>(i) * n + j];
+        return M;
+    }
+
+private:
+    std::vector<double> Ac, yc; // bloque desplazado (se reutiliza entre bloques)
+};
+
+// -----------------------------
+// Resolver (ATA) θ = ATy
+//
+// Usamos LAPACKE_dposv:
+// - Factoriza ATA = U^T U (Cholesky) leyendo solo el triángulo
+//   superior (el que llenó dsyrk): la mitad de flops que LU.
+// - Modifica la matriz y el vector en sitio.
+// Si ATA no es definida positiva (info > 0), o el redondeo deja un
+// pivote U_jj despreciable (columnas colineales), se repite con
+// LAPACKE_dgesv (LU + pivoteo parcial).
+//
+// Con nrhs > 1 las nrhs columnas de ATy se resuelven con la misma
+// factorización (nrhs de dposv/dgesv). Con --cache DIR la factorización se
+// guarda con el hash de ATA como clave
+// (U de Cholesky, o L·U y los pivotes de dgesv); si ya está, solo quedan
+// las sustituciones con dpotrs/dgetrs sobre el factor mapeado.
+// -----------------------------
+struct CacheUse {
+    bool hit = false;
+    FactorKind kind = FactorKind::chol;
+    std::string path;
+};
+
+static bool cholesky_ok(const std::vector<double>& U, int n) {
+    double dmin = U[0], dmax = U[0];
+    for (int j = 1; j < n; ++j) {
+        dmin = std::min(dmin, U[static_cast<size_t>(j) * n + j]);
+        dmax = std::max(dmax, U[static_cast<size_t>(j) * n + j]);
+    }
+    const double ratio = dmin / dmax;
+    return ratio * ratio > n * std::numeric_limits<double>::epsilon();
+}
+
+static CacheUse solve_normal(const NormalEquations& ne, const FactorCache& cache, std::vector<double>& theta) {
+    const int n = ne.n;
+    const size_t nn = static_cast<size_t>(n) * n;
+    const uint64_t key = cache.enabled() ? hash_matrix(Matrix<const double>(ne.ATA.data(), n, n)) : 0;
+    CacheUse use;
+    theta = ne.ATy; // copiamos ATy porque dposv sobrescribe b
+    const Matrix<double> rhs(theta.data(), n, ne.nrhs);
+
+    CacheEntry entry;
+    if (cache.load(FactorKind::chol, key, n, n, 0, entry)) {
+        lapack_check(potrs('U', Matrix<const double>(entry.array<double>(0, nn), n, n), rhs), "LAPACKE_dpotrs");
+        return {true, FactorKind::chol, entry.path()};
+    }
+    if (cache.load(FactorKind::lu, key, n, n, 0, entry)) {
+        lapack_check(getrs(Matrix<const double>(entry.array<double>(0, nn), n, n),
+                           entry.array<lapack_int>(1, static_cast<size_t>(n)), rhs),
+                     "LAPACKE_dgetrs");
+        return {true, FactorKind::lu, entry.path()};
+    }
+
+    std::vector<double> ATA = ne.ATA; // dposv sobrescribe la matriz
+    lapack_int info = posv(
+        'U',                                // triángulo superior
+        Matrix<double>(ATA.data(), n, n),   // matriz A (ATA), leading dimension = n
+        rhs                                 // b (ATy), nrhs columnas
+    );
+    if (info < 0) lapack_check(info, "LAPACKE_dposv");
+    if (info == 0 && !cholesky_ok(ATA, n)) info = n;
+    if (info == 0) {
+        use.path = cache.store(FactorKind::chol, key, n, n, 0, {CacheArray(ATA.data(), nn)});
+        return use;
+    }
+
+    std::cerr << "Aviso: A^T A no es definida positiva (dposv info=" << info << "); se usa LU (dgesv).\n";
+    ATA = ne.full_ATA();
+    theta = ne.ATy;
+    std::vector<lapack_int> ipiv(n); // pivotes
+    lapack_check(gesv(Matrix<double>(ATA.data(), n, n), ipiv.data(), rhs),
+                 "LAPACKE_dgesv", "matriz singular; no se pudo resolver");
+    use.kind = FactorKind::lu;
+    use.path = cache.store(FactorKind::lu, key, n, n, 0,
+                           {CacheArray(ATA.data(), nn), CacheArray(ipiv.data(), static_cast<size_t>(n))});
+    return use;
+}
+
+// -----------------------------
+// Camino rápido para 2 parámetros
+//
+// Los bloques de kSumBlock elementos se suman en kSumLanes acumuladores
+// independientes (bucle sin dependencias: el compilador lo vectoriza con
+// -O3 / -ftree-vectorize) y cada suma de bloque se agrega al total con
+// compensación de Kahan. El error queda acotado por el bloque, no por m.
+// -----------------------------
+static constexpr int kSumBlock = 256;
+static constexpr int kSumLanes = 4;
+
+struct KahanSum {
+    double sum = 0.0, comp = 0.0;
+    void add(double v) {
+        const double yk = v - comp;
+        const double t = sum + yk;
+        comp = (t - sum) - yk;
+        sum = t;
+    }
+};
+
+struct LinearSums {
+    double x0 = 0.0, y0 = 0.0; // desplazamiento (primer punto)
+    KahanSum su, sv, suu, suv, svv;
+    long long count = 0;
+
+    // A (rows×2, column-major): la columna 0 es x; la columna 1 (unos) no se usa
+    void add_chunk(const double* A, const double* y, int rows) {
+        if (rows == 0) return;
+        if (count == 0) {
+            x0 = A[0];
+            y0 = y[0];
+        }
+        const double* x = A;
+        for (int i0 = 0; i0 < rows; i0 += kSumBlock) {
+            const int len = std::min(kSumBlock, rows - i0);
+            double s[5][kSumLanes] = {};
+            int i = 0;
+            for (; i + kSumLanes <= len; i += kSumLanes) {
+                for (int k = 0; k < kSumLanes; ++k) {
+                    const double u = x[i0 + i + k] - x0, v = y[i0 + i + k] - y0;
+                    s[0][k] += u;
+                    s[1][k] += v;
+                    s[2][k] += u * u;
+                    s[3][k] += u * v;
+                    s[4][k] += v * v;
+                }
+            }
+            for (; i < len; ++i) {
+                const double u = x[i0 + i] - x0, v = y[i0 + i] - y0;
+                s[0][0] += u;
+                s[1][0] += v;
+                s[2][0] += u * u;
+                s[3][0] += u * v;
+                s[4][0] += v * v;
+            }
+            KahanSum* acc[5] = {&su, &sv, &suu, &suv, &svv};
+            for (int q = 0; q < 5; ++q) acc[q]->add((s[q][0] + s[q][1]) + (s[q][2] + s[q][3]));
+        }
+        count += rows;
+    }
+
+    // Solución en forma cerrada: a = Suv / Suu, b = ȳ - a x̄, SSE = Svv - a Suv
+    void solve(double& a, double& b, double& sse) const {
+        const double N = static_cast<double>(count);
+        const double mu = su.sum / N, mv = sv.sum / N;
+        const double Suu = suu.sum - su.sum * mu;
+        const double Suv = suv.sum - su.sum * mv;
+        const double Svv = svv.sum - sv.sum * mv;
+        if (!(Suu > 0.0)) throw std::runtime_error("Todos los x son iguales; la recta no está determinada.");
+        a = Suv / Suu;
+        b = (y0 + mv) - a * (x0 + mu);
+        sse = std::max(0.0, Svv - a * Suv);
+    }
+};
+
+// Bloque de filas de A = [x 1] (column-major) y de y
+struct Chunk {
+    std::vector<double> A = std::vector<double>(static_cast<size_t>(kChunkRows) * 2);
+    std::vector<double> y = std::vector<double>(kChunkRows);
+    int rows = 0;
+
+    void push(double xi, double yi) {
+        A[rows] = xi;              // columna 0: x
+        A[kChunkRows + rows] = 1.0; // columna 1: 1
+        y[rows] = yi;
+        ++rows;
+    }
+};
+
+template <class Sink>
+static void flush_chunk(Chunk& c, Sink& sink) {
+    // Con menos de kChunkRows filas, A ocupa las primeras `rows` de cada columna:
+    // compactamos la columna 1 para que el leading dimension sea `rows`
+    if (c.rows < kChunkRows) std::memmove(c.A.data() + c.rows, c.A.data() + kChunkRows, c.rows * sizeof(double));
+    sink.add_chunk(c.A.data(), c.y.data(), c.rows);
+    c.rows = 0;
+}
+
+static bool is_sep(char ch) { return ch == ' ' || ch == '\t' || ch == '\r' || ch == ','; }
 
-int main() {
+static bool parse_field(const char*& p, const char* end, double& v) {
+    while (p < end && is_sep(*p)) ++p;
+    if (p < end && *p == '+') ++p;
+    const auto r = std::from_chars(p, end, v);
+    if (r.ec != std::errc{}) return false;
+    p = r.ptr;
+    return true;
+}
+
+// Lee registros "x y" de `in` por bloques de kReadBytes y los acumula en sink
+// (NormalEquations o LinearSums)
+template <class Sink>
+static void stream_points(std::istream& in, Sink& sink) {
+    Chunk chunk;
+    std::vector<char> buf(kReadBytes);
+    size_t keep = 0;      // bytes de una línea incompleta al inicio de buf
+    long long line_no = 0;
+    bool eof = false;
+    while (!eof) {
+        if (keep == buf.size()) buf.resize(buf.size() * 2); // línea más larga que el buffer
+        in.read(buf.data() + keep, static_cast<std::streamsize>(buf.size() - keep));
+        const size_t got = static_cast<size_t>(in.gcount());
+        eof = got < buf.size() - keep;
+        const char* p = buf.data();
+        const char* end = p + keep + got;
+
+        while (p < end) {
+            const char* nl = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+            if (!nl && !eof) break; // línea incompleta: se completa en la siguiente lectura
+            const char* le = nl ? nl : end;
+            ++line_no;
+
+            const char* q = p;
+            while (q < le && is_sep(*q)) ++q;
+            if (q < le) {
+                double xi = 0.0, yi = 0.0;
+                if (!parse_field(q, le, xi) || !parse_field(q, le, yi))
+                    throw std::runtime_error("Registro inválido en la línea " + std::to_string(line_no) +
+                                             ". Se espera: x y");
+                chunk.push(xi, yi);
+                if (chunk.rows == kChunkRows) flush_chunk(chunk, sink);
+            }
+            p = nl ? nl + 1 : end;
+        }
+        keep = static_cast<size_t>(end - p);
+        if (keep > 0) std::memmove(buf.data(), p, keep);
+    }
+    flush_chunk(chunk, sink);
+}
+
+// Lee los puntos de data_path ("" => x, y en memoria; "-" => stdin) en sink
+template <class Sink>
+static void accumulate_points(const std::string& data_path, const std::vector<double>& x,
+                              const std::vector<double>& y, Sink& sink) {
+    if (data_path.empty()) {
+        Chunk chunk;
+        for (size_t i = 0; i < x.size(); ++i) chunk.push(x[i], y[i]);
+        flush_chunk(chunk, sink);
+    } else if (data_path == "-") {
+        stream_points(std::cin, sink);
+    } else {
+        std::ifstream fin(data_path, std::ios::binary);
+        if (!fin) throw std::runtime_error("No se pudo abrir el archivo de datos: " + data_path);
+        stream_points(fin, sink);
+    }
+}
+
+// Modo --batch: una recta por serie con el camino rápido (sin BLAS ni memoria por ajuste)
+static void run_batch_fits(const std::string& in_path, const std::string& out_path) {
+    SeriesTable t;
+    load_series(in_path, t);
+    std::vector<double> results(t.count() * 3); // a, b, sse
+    struct NoScratch {};
+    parallel_series(t.count(), NoScratch{}, [&](size_t s, NoScratch&) {
+        double* r = results.data() + s * 3;
+        const size_t off = t.offsets[s], len = t.length(s);
+        r[0] = r[1] = r[2] = std::numeric_limits<double>::quiet_NaN();
+        if (len < 2) return;
+        // LinearSums lee x como la columna 0 de A: el tramo x[off..] sirve tal cual
+        LinearSums sums;
+        sums.add_chunk(t.x.data() + off, t.y.data() + off, static_cast<int>(len));
+        try {
+            sums.solve(r[0], r[1], r[2]);
+        } catch (const std::runtime_error&) {
+            r[0] = r[1] = r[2] = std::numeric_limits<double>::quiet_NaN(); // x constantes
+        }
+    });
+    write_fit_results(out_path, t, {"a", "b"}, results);
+    std::cout << "OK: " << t.count() << " rectas ajustadas -> " << out_path << "\n";
+}
+
+// -----------------------------
+// Modo --multi: k respuestas sobre la misma x
+//
+// ATA es la misma para todas: se acumula una vez (por bloques de kChunkRows
+// filas, como --general), ATY = A^T [y_1 ... y_k] con un dgemm por bloque, y
+// una sola factorización resuelve las k columnas (ver solve_normal).
+// -----------------------------
+// ATA y ATY de x (m) e Y (m×k column-major), por bloques de kChunkRows filas
+static NormalEquations multi_normal_equations(const double* x, const double* Y, int m, int k) {
+    const int n = 2;
+    if (m < n) throw std::runtime_error("Se necesitan al menos " + std::to_string(n) + " puntos.");
+
+    NormalEquations ne(n, k);
+    std::vector<double> A(static_cast<size_t>(std::min(kChunkRows, m)) * n);
+    for (int r0 = 0; r0 < m; r0 += kChunkRows) {
+        const int rows = std::min(kChunkRows, m - r0);
+        std::copy_n(x + r0, rows, A.data());     // columna 0: x
+        std::fill_n(A.data() + rows, rows, 1.0); // columna 1: 1 (lda = rows)
+        ne.add_chunk(A.data(), Y + r0, rows, m);
+    }
+    return ne;
+}
+
+static void run_multi_fits(const std::string& in_path, const std::string& out_path, const FactorCache& cache) {
+    ResponseTable t;
+    read_responses(in_path, t);
+    const int m = static_cast<int>(t.rows()), k = static_cast<int>(t.count()), n = 2;
+    const NormalEquations ne = multi_normal_equations(t.x.data(), t.Y.data(), m, k);
+
+    std::vector<double> theta;
+    const CacheUse cache_use = solve_normal(ne, cache, theta);
+    const std::vector<double> coef = ne.coefficients(theta);
+    std::vector<double> results(t.count() * 3); // a, b, sse
+    for (int j = 0; j < k; ++j) {
+        results[j * 3] = coef[static_cast<size_t>(j) * n];
+        results[j * 3 + 1] = coef[static_cast<size_t>(j) * n + 1];
+        results[j * 3 + 2] = ne.sse(theta, j);
+    }
+    write_response_results(out_path, t, {"a", "b"}, results);
+    std::cout << "OK: " << k << " rectas sobre " << m << " puntos (una factorizacion, nrhs = " << k << ") -> "
+              << out_path << "\n";
+    if (cache.enabled())
+        std::cout << "Cache " << (cache_use.kind == FactorKind::chol ? "Cholesky" : "LU") << ": "
+                  << (cache_use.hit ? "reutilizada de " : "guardada en ") << cache_use.path << "\n";
+}
+
+// -----------------------------
+// Modo --serve: trabajos kJobFit (x, Y -> a y b, sse)
+//
+// Igual que --multi, con x e Y desde el payload; param se ignora (el modelo
+// es siempre la recta). Con --cache, la misma x reutiliza la factorización
+// de ATA. Respuesta: coeficientes (2×k, filas a y b) y sse (1×k).
+// -----------------------------
+static void run_server(const std::string& addr, const FactorCache& cache) {
+    AlignedBuffer<double> Ybuf;
+    serve(addr, [&](const JobFrame& req, const JobInput& in, JobOutput& out) {
+        if (req.op != kJobFit) throw unsupported_job(req);
+        const FitJob job = read_fit_job(in, Ybuf);
+        const NormalEquations ne = multi_normal_equations(job.x, job.Y, job.m, job.k);
+        std::vector<double> theta;
+        solve_normal(ne, cache, theta);
+
+        out.shape(kDtypeF64, kLayoutCol, {{2, job.k}, {1, job.k}});
+        const std::vector<double> coef = ne.coefficients(theta);
+        std::copy(coef.begin(), coef.end(), out.matrix<double>(0));
+        double* sse = out.matrix<double>(1);
+        for (int j = 0; j < job.k; ++j) sse[j] = ne.sse(theta, j);
+    });
+}
+
+// -----------------------------
+// Modo --online: recta actualizada con cada muestra (Givens sobre R 2×2)
+//
+// Los puntos de --data (si hay) pasan por las mismas rotaciones: es el QR de
+// [x 1] construido fila a fila. Cada --report-every muestras nuevas se
+// imprime "count,a,b,sse".
+// -----------------------------
+struct OnlineSink {
+    OnlineLS& ls;
+    void add_chunk(const double* A, const double* y, int rows) {
+        for (int i = 0; i < rows; ++i) {
+            const double phi[2] = {A[i], 1.0};
+            ls.add(phi, y[i]);
+        }
+    }
+};
+
+static void run_online(const std::string& seed_path, const std::string& src, double forget, long long report_every) {
+    OnlineLS ls(2, forget);
+    if (!seed_path.empty()) {
+        OnlineSink sink{ls};
+        accumulate_points(seed_path, {}, {}, sink);
+    }
+    std::cout << "count,a,b,sse\n";
+    std::vector<double> theta(2);
+    long long seen = 0;
+    auto on_sample = [&](double xi, double yi) {
+        const double phi[2] = {xi, 1.0};
+        ls.add(phi, yi);
+        if (++seen % report_every == 0) print_online_state(std::cout, ls, theta);
+    };
+    if (src == "-") {
+        for_each_sample(std::cin, on_sample);
+    } else {
+        std::ifstream fin(src);
+        if (!fin) throw std::runtime_error("No se pudo abrir el archivo de muestras: " + src);
+        for_each_sample(fin, on_sample);
+    }
+    if (seen % report_every != 0 || seen == 0) print_online_state(std::cout, ls, theta);
+}
+
+int main(int argc, char** argv) {
     try {
-        // -----------------------------
-        // 0) Datos
-        // -----------------------------
-        // Puntos: (x_i, y_i)
-        const std::vector<double> x = {1, 2, 3, 4};
-        const std::vector<double> y_rm = {2, 2, 4, 5}; // lo guardamos "como lista" (row-major conceptual)
-        const int m = static_cast<int>(x.size());      // número de muestras (filas)
-        const int n = 2;                               // número de parámetros: a y b
+        std::string data_path; // vacío => datos de la imagen
+        bool general = false;  // true => dsyrk + dgemv + dposv
+        bool no_points = false; // omite la tabla por punto
+        std::string online_src; // --online: muestras nuevas ("-" => stdin)
+        double forget = 1.0;    // factor de olvido λ (1 => sin olvido)
+        long long report_every = 1;
+        std::string cache_dir;  // --cache: directorio de la caché de factorizaciones
+        std::string batch_in, batch_out; // --batch: una recta por serie
+        std::string multi_in, multi_out; // --multi: k respuestas, una sola factorización
+        std::string serve_addr; // --serve: unix:RUTA o tcp:HOST:PUERTO
+        for (int i = 1; i < argc; ++i) {
+            const std::string a = argv[i];
+            if (a == "--data" && i + 1 < argc) {
+                data_path = argv[++i];
+            } else if (a == "--general") {
+                general = true;
+            } else if (a == "--cache" && i + 1 < argc) {
+                cache_dir = argv[++i];
+            } else if (a == "--no-points") {
+                no_points = true;
+            } else if (a == "--online" && i + 1 < argc) {
+                online_src = argv[++i];
+            } else if (a == "--forget" && i + 1 < argc) {
+                forget = std::atof(argv[++i]);
+                if (!(forget > 0.0 && forget <= 1.0)) throw std::runtime_error("--forget debe estar en (0, 1].");
+            } else if (a == "--report-every" && i + 1 < argc) {
+                report_every = std::atoll(argv[++i]);
+                if (report_every <= 0) throw std::runtime_error("--report-every debe ser un entero positivo.");
+            } else if (runtime_option(argc, argv, i) || serve_option(argc, argv, i)) {
+            } else if (a == "--batch" && i + 2 < argc) {
+                batch_in = argv[++i];
+                batch_out = argv[++i];
+            } else if (a == "--multi" && i + 2 < argc) {
+                multi_in = argv[++i];
+                multi_out = argv[++i];
+            } else if (a == "--serve" && i + 1 < argc) {
+                serve_addr = argv[++i];
+            } else {
+                std::cerr << "Uso: " << argv[0] << " [--general [--cache <dir>]] [--data <puntos.txt|->] [--no-points]\n"
+                          << "     " << argv[0] << " --batch <series.csv> <ajustes.csv>\n"
+                          << "     " << argv[0] << " --multi <respuestas.csv> <ajustes.csv> [--cache <dir>]\n"
+                          << "     " << argv[0] << " [--data <iniciales.txt>] --online <nuevas.txt|->"
+                             " [--forget λ] [--report-every K]\n"
+                          << "     " << argv[0] << " [--cache <dir>] --serve unix:RUTA|tcp:HOST:PUERTO [--max-payload MiB]\n"
+                          << "  (todos los modos) " << kRuntimeUsage << "\n";
+                return 1;
+            }
+        }
+        apply_runtime();
 
-        // -----------------------------
-        // 1) Construir A (m×n) en column-major
-        //    A = [x  1]
-        //
-        // Column-major significa:
-        // A_colmajor(j*m + i) = A(i,j)
-        // -----------------------------
-        std::vector<double> A(static_cast<size_t>(m) * n);
-        for (int i = 0; i < m; ++i) {
-            A[0 * m + i] = x[i];  // columna 0: x
-            A[1 * m + i] = 1.0;   // columna 1: 1
+        if (!serve_addr.empty()) {
+            if (!multi_in.empty() || !batch_in.empty() || !online_src.empty() || !data_path.empty())
+                throw std::runtime_error("--serve no se combina con --data, --batch, --multi ni --online.");
+            run_server(serve_addr, FactorCache(cache_dir));
+            return 0;
         }
+        if (serve_config().max_payload_set) throw std::runtime_error("--max-payload requiere --serve.");
+        if (!batch_in.empty()) {
+            // --batch usa siempre el camino rápido y lee sus series de batch_in
+            if (!multi_in.empty() || !online_src.empty() || !data_path.empty() || general || !cache_dir.empty() ||
+                no_points)
+                throw std::runtime_error(
+                    "--batch no se combina con --data, --general, --cache, --no-points, --multi ni --online.");
+            run_batch_fits(batch_in, batch_out);
+            return 0;
+        }
+        if (!multi_in.empty()) {
+            if (!online_src.empty()) throw std::runtime_error("--multi no se combina con --online.");
+            run_multi_fits(multi_in, multi_out, FactorCache(cache_dir));
+            return 0;
+        }
+        if (!cache_dir.empty() && !general)
+            throw std::runtime_error("--cache requiere --general (el camino rápido no factoriza).");
+        if (!cache_dir.empty() && !online_src.empty()) throw std::runtime_error("--cache no se combina con --online.");
 
-        // Vector y como columna (m×1). Para BLAS/LAPACK, es un vector.
-        std::vector<double> y = y_rm;
+        if (!online_src.empty()) {
+            run_online(data_path, online_src, forget, report_every);
+            return 0;
+        }
 
-        // -----------------------------
-        // 2) Calcular ATA = A^T A (n×n)
-        //    y ATy = A^T y (n×1)
-        // -----------------------------
-        std::vector<double> ATA(static_cast<size_t>(n) * n, 0.0); // n×n
-        std::vector<double> ATy(static_cast<size_t>(n), 0.0);     // n×1
-
-        // ATA = A^T * A
-        // cblas_dgemm: C = alpha * op(A) * op(B) + beta*C
-        // Aquí:
-        //   op(A) = A^T (n×m)
-        //   op(B) = A   (m×n)
-        //   C     = ATA (n×n)
-        cblas_dgemm(
-            CblasColMajor,
-            CblasTrans, CblasNoTrans,
-            n, n, m,
-            1.0,
-            A.data(), m,
-            A.data(), m,
-            0.0,
-            ATA.data(), n
-        );
-
-        // ATy = A^T * y
-        // cblas_dgemv: y_out = alpha*op(A)*x + beta*y_out
-        cblas_dgemv(
-            CblasColMajor,
-            CblasTrans,
-            m, n,
-            1.0,
-            A.data(), m,
-            y.data(), 1,
-            0.0,
-            ATy.data(), 1
-        );
+        const int n = 2; // número de parámetros: a y b
 
         // -----------------------------
-        // 3) Resolver (ATA) * theta = ATy
-        //    theta = [a, b]^T
-        //
-        // Usamos LAPACKE_dgesv:
-        // - Resuelve sistemas lineales Ax=b con LU + pivoteo parcial.
-        // - Modifica la matriz y el vector en sitio.
+        // 0) Datos
         // -----------------------------
-        std::vector<int> ipiv(n);              // pivotes
-        std::vector<double> theta = ATy;       // copiamos ATy porque dgesv sobrescribe b
+        // Puntos: (x_i, y_i)
+        std::vector<double> x = {1, 2, 3, 4};
+        std::vector<double> y = {2, 2, 4, 5};
 
-        int info = LAPACKE_dgesv(
-            LAPACK_COL_MAJOR,
-            n,        // orden de A (n×n)
-            1,        // nrhs: número de columnas de b (aquí 1)
-            ATA.data(), n, // matriz A (ATA), leading dimension = n
-            ipiv.data(),
-            theta.data(), n  // b (ATy), leading dimension = n
-        );
+        double a = 0.0, b = 0.0, sse_fit = 0.0;
+        long long count = 0;
+        const FactorCache cache(cache_dir);
+        CacheUse cache_use;
 
-        if (info < 0) {
-            throw std::runtime_error("LAPACKE_dgesv: argumento ilegal en posición " + std::to_string(-info));
-        }
-        if (info > 0) {
-            throw std::runtime_error("LAPACKE_dgesv: matriz singular; no se pudo resolver (info=" + std::to_string(info) + ")");
-        }
+        if (!general) {
+            // -----------------------------
+            // Camino rápido: una pasada con sumas compensadas y solución 2×2
+            // -----------------------------
+            LinearSums sums;
+            accumulate_points(data_path, x, y, sums);
+            if (sums.count < n) throw std::runtime_error("Se necesitan al menos " + std::to_string(n) + " puntos.");
+            sums.solve(a, b, sse_fit);
+            count = sums.count;
+        } else {
+            NormalEquations ne(n);
+
+            // -----------------------------
+            // 1) y 2) Leer por bloques y acumular ATA = A^T A (n×n), ATy = A^T y (n×1)
+            //
+            // Cada bloque A_k = [x 1] (rows×n) se guarda en column-major:
+            // A_colmajor(j*rows + i) = A(i,j)
+            // -----------------------------
+            accumulate_points(data_path, x, y, ne);
+            if (ne.count < n) throw std::runtime_error("Se necesitan al menos " + std::to_string(n) + " puntos.");
 
-        const double a = theta[0];
-        const double b = theta[1];
+            // -----------------------------
+            // 3) Resolver (ATA) * theta = ATy (Cholesky o LU; ver solve_normal)
+            //    theta = [a, b]^T
+            // -----------------------------
+            std::vector<double> theta;
+            cache_use = solve_normal(ne, cache, theta);
+
+            const std::vector<double> coef = ne.coefficients(theta);
+            a = coef[0];
+            b = coef[1];
+            sse_fit = ne.sse(theta, 0);
+            count = ne.count;
+        }
 
         // -----------------------------
         // 4) Mostrar resultado
@@ -135,17 +693,27 @@ int main() {
         std::cout << "a = " << a << "\n";
         std::cout << "b = " << b << "\n\n";
 
-        // Opcional: mostrar predicciones y error cuadrático medio
-        double sse = 0.0;
-        std::cout << "Puntos y prediccion:\n";
-        for (int i = 0; i < m; ++i) {
-            double y_hat = a * x[i] + b;
-            double err = y_hat - y[i];
-            sse += err * err;
-            std::cout << "x=" << x[i] << "  y=" << y[i] << "  y_hat=" << y_hat << "  err=" << err << "\n";
-        }
-        std::cout << "\nSSE = " << sse << "\n";
-        std::cout << "MSE = " << (sse / m) << "\n";
+        // El SSE ya sale del acumulador (sin volver a leer ni evaluar los datos)
+        const double sse = sse_fit;
+        // Con streaming los puntos no se guardan: la tabla solo existe en memoria
+        const bool show_points = data_path.empty() && !no_points;
+        if (show_points) {
+            // Opcional: mostrar predicciones
+            std::cout << "Puntos y prediccion:\n";
+            for (size_t i = 0; i < x.size(); ++i) {
+                double y_hat = a * x[i] + b;
+                double err = y_hat - y[i];
+                std::cout << "x=" << x[i] << "  y=" << y[i] << "  y_hat=" << y_hat << "  err=" << err << "\n";
+            }
+            std::cout << "\n";
+        } else {
+            std::cout << "Puntos: " << count << "\n";
+        }
+        std::cout << "SSE = " << sse << "\n";
+        std::cout << "MSE = " << (sse / static_cast<double>(count)) << "\n";
+        if (cache.enabled())
+            std::cout << "Cache " << (cache_use.kind == FactorKind::chol ? "Cholesky" : "LU") << ": "
+                      << (cache_use.hit ? "reutilizada de " : "guardada en ") << cache_use.path << "\n";
 
         return 0;
     } catch (const std::exception& ex) {
@@ -10,137 +10,1138 @@
 // m l
 // C: m líneas, cada una con l doubles
 //
-// Nota: DGEMM (Fortran) espera column-major. Leemos row-major y convertimos.
+// Entrada/salida binaria (se detecta automáticamente por el "magic" MCSM):
+//   cabecera de 64 bytes (ver BinHeader) + matrices de doubles crudos,
+//   cada una alineada a 64 bytes. La entrada lleva A y B; la salida lleva C.
+//   Ambos archivos se mapean en memoria (mmap / MapViewOfFile): DGEMM lee
+//   A y B directamente del mapeo y escribe C directamente en el archivo.
+//
+// Nota: DGEMM (Fortran) espera column-major. Un buffer row-major de (r×c) es,
+// visto en column-major, la transpuesta (c×r) con leading dimension c.
+// Por eso no convertimos: calculamos C^T = B^T * A^T directamente sobre los
+// buffers row-major y el resultado C^T (column-major) ya es C en row-major.
+// Solo se reservan A, B y C.
 //
 // Compilación (MSYS2 ucrt64 + OpenBLAS):
 //   g++ -std=c++23 -O2 -Wall -Wextra matmul_dgemm_general.cpp -o matmul.exe -lopenblas
+//   (con --serve en Windows, agregar -lws2_32)
 //
 // Ejecución:
 //   ./matmul.exe input.txt output.txt
+//   ./matmul.exe input.bin output.bin                 (binario: salida binaria)
+//   ./matmul.exe --out-format txt input.bin output.txt
+//   ./matmul.exe --to-bin input.txt input.bin         (convierte texto -> binario)
+//   ./matmul.exe --to-bin --layout col input.txt input.bin (binario column-major)
+//   ./matmul.exe --batch problemas.txt resultados.txt (muchos "m n l / A / B" seguidos)
+//   cat problemas.txt | ./matmul.exe --batch - -
+//   ./matmul.exe --tile 4096 input.bin output.bin     (out-of-core por bloques)
+//   ./matmul.exe --stats input.txt output.txt         (o MCS_STATS=1): JSON por fase en stderr
+//   ./matmul.exe --precision f32 input.txt output.txt (SGEMM; también "mixed")
+//   ./matmul.exe --precision mixed --check input.txt output.txt (error relativo vs f64)
+//   ./matmul.exe --threads 16 --bind spread input.bin output.bin (hilos y afinidad NUMA)
+//   ./matmul.exe --pipeline input.txt output.txt      (lectura, DGEMM y escritura solapadas)
+//   ./matmul.exe --batch --pipeline problemas.txt resultados.txt
+//   ./matmul.exe --serve unix:/tmp/mcs.sock            (servidor de productos; ver server.hpp)
+
+#include "matmul_core.hpp"
+#include "../../include/mcs/server.hpp" // --serve
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <filesystem>
 #include <fstream>
-#include <iomanip>
 #include <iostream>
 #include <stdexcept>
 #include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
-extern "C" {
-// DGEMM: C = alpha*op(A)*op(B) + beta*C
-void dgemm_(const char* TRANSA, const char* TRANSB,
-            const int* M, const int* N, const int* K,
-            const double* ALPHA,
-            const double* A, const int* LDA,
-            const double* B, const int* LDB,
-            const double* BETA,
-            double* C, const int* LDC);
-}
-
-static std::vector<double> read_matrix_row_major(std::istream& in, int rows, int cols, const std::string& name) {
-    std::vector<double> M(static_cast<size_t>(rows) * cols);
-    for (int i = 0; i < rows; ++i) {
-        for (int j = 0; j < cols; ++j) {
-            if (!(in >> M[static_cast<size_t>(i) * cols + j])) {
-                throw std::runtime_error("Error leyendo matriz " + name +
-                                         " en (" + std::to_string(i) + "," + std::to_string(j) + ").");
+#ifdef MCS_HAVE_DGEMM_BATCH
+#include <cblas.h> // cblas_dgemm_batch
+#endif
+
+// -----------------------------
+// Modo out-of-core (--tile T): para productos que no caben en memoria
+//
+// A y B se leen del archivo binario por bloques (tiles) de T×T. Para cada
+// bloque C_ij se acumula C_ij += A_ik * B_kj con DGEMM (beta = 1 desde el
+// segundo k) y el bloque terminado se escribe en su lugar en la salida.
+// Memoria: 3·T² doubles. E/S: ~2·m·n·l/T doubles leídos. Más T => más RAM
+// y menos lecturas.
+// -----------------------------
+
+// Lee el bloque [r0,r1)×[c0,c1) de una matriz (rows×cols) guardada en `layout`
+// a partir de `base`. El bloque queda contiguo en el mismo layout.
+static void read_tile(std::ifstream& f, size_t base, uint8_t layout, int rows, int cols,
+                      int r0, int r1, int c0, int c1, double* dst) {
+    // En row-major las "líneas" contiguas son filas; en column-major, columnas
+    const bool row = (layout == kLayoutRow);
+    const int ld = row ? cols : rows;
+    const int l0 = row ? r0 : c0, l1 = row ? r1 : c1; // líneas del bloque
+    const int e0 = row ? c0 : r0, e1 = row ? c1 : r1; // elementos por línea
+    const size_t len = static_cast<size_t>(e1 - e0);
+
+    if (static_cast<int>(len) == ld) {
+        // Líneas completas: una sola lectura
+        f.seekg(static_cast<std::streamoff>(base + static_cast<size_t>(l0) * ld * sizeof(double)));
+        f.read(reinterpret_cast<char*>(dst), static_cast<std::streamsize>((l1 - l0) * len * sizeof(double)));
+    } else {
+        for (int i = l0; i < l1; ++i) {
+            f.seekg(static_cast<std::streamoff>(base + (static_cast<size_t>(i) * ld + e0) * sizeof(double)));
+            f.read(reinterpret_cast<char*>(dst + (i - l0) * len), static_cast<std::streamsize>(len * sizeof(double)));
+        }
+    }
+    if (!f) throw std::runtime_error("Error leyendo un bloque del archivo de entrada.");
+}
+
+// Escribe el bloque (contiguo, en `layout`) en su lugar dentro de la salida
+static void write_tile(std::fstream& f, size_t base, uint8_t layout, int rows, int cols,
+                       int r0, int r1, int c0, int c1, const double* src) {
+    const bool row = (layout == kLayoutRow);
+    const int ld = row ? cols : rows;
+    const int l0 = row ? r0 : c0, l1 = row ? r1 : c1;
+    const int e0 = row ? c0 : r0, e1 = row ? c1 : r1;
+    const size_t len = static_cast<size_t>(e1 - e0);
+
+    if (static_cast<int>(len) == ld) {
+        f.seekp(static_cast<std::streamoff>(base + static_cast<size_t>(l0) * ld * sizeof(double)));
+        f.write(reinterpret_cast<const char*>(src), static_cast<std::streamsize>((l1 - l0) * len * sizeof(double)));
+    } else {
+        for (int i = l0; i < l1; ++i) {
+            f.seekp(static_cast<std::streamoff>(base + (static_cast<size_t>(i) * ld + e0) * sizeof(double)));
+            f.write(reinterpret_cast<const char*>(src + (i - l0) * len), static_cast<std::streamsize>(len * sizeof(double)));
+        }
+    }
+    if (!f) throw std::runtime_error("Error escribiendo un bloque del archivo de salida.");
+}
+
+static void run_out_of_core(const std::string& in_path, const std::string& out_path, int tile,
+                            int& m, int& n, int& l, Stats& stats) {
+    std::ifstream fin(in_path, std::ios::binary);
+    if (!fin) throw std::runtime_error("No se pudo abrir el archivo de entrada: " + in_path);
+    BinHeader hin{};
+    if (!fin.read(reinterpret_cast<char*>(&hin), sizeof(hin)))
+        throw std::runtime_error("Archivo binario truncado (cabecera incompleta).");
+    fin.seekg(0, std::ios::end);
+    validate_bin_input(hin, static_cast<size_t>(fin.tellg()), m, n, l);
+    if (hin.dtype != kDtypeF64) throw std::runtime_error("El modo out-of-core (--tile) requiere una entrada f64.");
+    const uint8_t layout = hin.layout;
+    const size_t a_base = bin_offset(hin, 0);
+    const size_t b_base = bin_offset(hin, 1);
+
+    BinHeader hout = make_header(layout, 1);
+    hout.dims[0][0] = static_cast<uint64_t>(m);
+    hout.dims[0][1] = static_cast<uint64_t>(l);
+    {
+        std::ofstream create(out_path, std::ios::binary | std::ios::trunc);
+        if (!create.write(reinterpret_cast<const char*>(&hout), sizeof(hout)))
+            throw std::runtime_error("No se pudo abrir el archivo de salida: " + out_path);
+    }
+    std::filesystem::resize_file(out_path, bin_file_size(hout));
+    std::fstream fout(out_path, std::ios::binary | std::ios::in | std::ios::out);
+    if (!fout) throw std::runtime_error("No se pudo abrir el archivo de salida: " + out_path);
+    const size_t c_base = bin_offset(hout, 0);
+
+    // Cada lado del bloque se recorta a la dimensión real: --tile 200000 con
+    // una entrada 2×2 reserva bloques 2×2, no tres de 200000²
+    const size_t ti = static_cast<size_t>(std::min(tile, m));
+    const size_t tk = static_cast<size_t>(std::min(tile, n));
+    const size_t tj = static_cast<size_t>(std::min(tile, l));
+    const size_t max_elems = SIZE_MAX / sizeof(double);
+    if (ti > max_elems / tk || tk > max_elems / tj || ti > max_elems / tj)
+        throw std::runtime_error("--tile demasiado grande: los bloques no caben en memoria direccionable.");
+    AlignedBuffer<double> At(ti * tk), Bt(tk * tj), Ct(ti * tj);
+    double t_read = 0.0, t_gemm = 0.0, t_write = 0.0, bytes_read = 0.0;
+
+    for (int i0 = 0; i0 < m; i0 += tile) {
+        const int i1 = std::min(m, i0 + tile);
+        for (int j0 = 0; j0 < l; j0 += tile) {
+            const int j1 = std::min(l, j0 + tile);
+            for (int k0 = 0; k0 < n; k0 += tile) {
+                const int k1 = std::min(n, k0 + tile);
+                Stopwatch sw_read;
+                read_tile(fin, a_base, layout, m, n, i0, i1, k0, k1, At.data());
+                read_tile(fin, b_base, layout, n, l, k0, k1, j0, j1, Bt.data());
+                t_read += sw_read.seconds();
+                bytes_read += static_cast<double>(sizeof(double)) * (k1 - k0) * ((i1 - i0) + (j1 - j0));
+
+                Stopwatch sw_gemm;
+                gemm_layouts(At.data(), layout, Bt.data(), layout, Ct.data(), layout,
+                             i1 - i0, k1 - k0, j1 - j0, k0 == 0 ? 0.0 : 1.0);
+                t_gemm += sw_gemm.seconds();
             }
+            Stopwatch sw_write;
+            write_tile(fout, c_base, layout, m, l, i0, i1, j0, j1, Ct.data());
+            t_write += sw_write.seconds();
         }
     }
-    return M;
+    fout.flush();
+
+    stats.add("read_tiles", t_read, bytes_read);
+    stats.add("dgemm", t_gemm, static_cast<double>(sizeof(double)) * (1.0 * m * n + 1.0 * n * l + 1.0 * m * l),
+              2.0 * m * n * l);
+    stats.add("write_tiles", t_write, static_cast<double>(sizeof(double)) * m * l);
 }
 
-// Row-major (rows×cols) -> Column-major (rows×cols)
-static std::vector<double> to_col_major(const std::vector<double>& rm, int rows, int cols) {
-    std::vector<double> cm(static_cast<size_t>(rows) * cols);
-    for (int i = 0; i < rows; ++i)
-        for (int j = 0; j < cols; ++j)
-            cm[static_cast<size_t>(j) * rows + i] = rm[static_cast<size_t>(i) * cols + j];
-    return cm;
+// Convierte una entrada de texto (m n l / A / B) al contenedor binario
+// (f64 o f32 según T) en el layout pedido
+template <class T>
+static void convert_text_to_bin(const std::string& in_path, const std::string& out_path, uint8_t layout) {
+    MappedFile fin;
+    fin.open_read(in_path);
+    const char* p = fin.data();
+    const char* end = p + fin.size();
+
+    int m = 0, n = 0, l = 0;
+    parse_text_dims(p, end, m, n, l);
+
+    BinHeader h = make_header(layout, 2, dtype_of<T>);
+    h.dims[0][0] = static_cast<uint64_t>(m); h.dims[0][1] = static_cast<uint64_t>(n);
+    h.dims[1][0] = static_cast<uint64_t>(n); h.dims[1][1] = static_cast<uint64_t>(l);
+
+    MappedFile out;
+    out.create(out_path, bin_file_size(h));
+    std::memcpy(out.data(), &h, sizeof(h));
+
+    T* A = reinterpret_cast<T*>(out.data() + bin_offset(h, 0));
+    T* B = reinterpret_cast<T*>(out.data() + bin_offset(h, 1));
+    if (layout == kLayoutRow) {
+        // Parseamos directo al archivo mapeado, sin buffer intermedio
+        parse_text_matrices(p, end, m, n, l, A, B);
+    } else {
+        // El texto es row-major: se parsea aparte y se transpone por bloques
+        AlignedBuffer<T> A_rm(static_cast<size_t>(m) * n), B_rm(static_cast<size_t>(n) * l);
+        parse_text_matrices(p, end, m, n, l, A_rm.data(), B_rm.data());
+        to_col_major(A_rm.data(), m, n, A);
+        to_col_major(B_rm.data(), n, l, B);
+    }
+    std::cout << "OK: " << in_path << " -> " << out_path << " (binario "
+              << (dtype_of<T> == kDtypeF32 ? "f32" : "f64") << ", "
+              << (layout == kLayoutRow ? "row-major" : "column-major") << ")\n";
 }
 
-// Column-major (rows×cols) -> Row-major (rows×cols)
-static std::vector<double> to_row_major(const std::vector<double>& cm, int rows, int cols) {
-    std::vector<double> rm(static_cast<size_t>(rows) * cols);
-    for (int i = 0; i < rows; ++i)
-        for (int j = 0; j < cols; ++j)
-            rm[static_cast<size_t>(i) * cols + j] = cm[static_cast<size_t>(j) * rows + i];
-    return rm;
+// -----------------------------
+// Precisión (--precision f64|f32|mixed) para el modo de un producto
+//
+// - f64  : A, B y C en double, DGEMM (por defecto)
+// - f32  : A, B y C en float, SGEMM (mitad de memoria y ancho de banda)
+// - mixed: A y B en float, SGEMM por paneles de kMixedPanel y C acumulada
+//          en double (ver gemm_mixed)
+// Con --check se recalcula C en f64 y se reporta el error relativo máximo
+// max|C - C_f64| / max|C_f64|.
+// -----------------------------
+enum class Precision { f64, f32, mixed };
+
+// A y B en tipo T. Si la entrada binaria ya está en T se usan desde el mapeo
+// (sin copia); si no, se convierten. El texto se parsea directamente a T.
+// Con --bind el mapeo se copia igual (place_local): las páginas del page
+// cache están en el nodo que leyó el archivo, la copia queda repartida entre
+// los nodos de los hilos de DGEMM.
+// Las copias (y C en texto) salen de mem: un solo bloque con páginas
+// grandes cuando se puede, así A, B y C no pagan un fallo por cada 4 KiB.
+template <class T>
+struct Operands {
+    int m = 0, n = 0, l = 0;
+    uint8_t layout = kLayoutRow;
+    const T* A = nullptr;
+    const T* B = nullptr;
+    MappedFile map;
+    Arena mem;
+};
+
+// Un bloque para A, B y C (C en double en el peor caso, 64 bytes de relleno)
+template <class T>
+static void reserve_operands(Operands<T>& op) {
+    const size_t na = static_cast<size_t>(op.m) * op.n, nb = static_cast<size_t>(op.n) * op.l;
+    op.mem.reserve((na + nb) * sizeof(T) + static_cast<size_t>(op.m) * op.l * sizeof(double) + 3 * kMatrixAlign);
 }
 
-static void write_matrix_row_major(std::ostream& out, const std::vector<double>& rm, int rows, int cols) {
-    out << rows << " " << cols << "\n";
-    out << std::setprecision(17);
-    for (int i = 0; i < rows; ++i) {
-        for (int j = 0; j < cols; ++j) {
-            out << rm[static_cast<size_t>(i) * cols + j];
-            if (j + 1 < cols) out << ' ';
+template <class T>
+static void load_operands(const std::string& in_path, bool bin_in, Operands<T>& op) {
+    op.map.open_read(in_path);
+    if (bin_in) {
+        const BinHeader& h = read_bin_input(op.map, op.m, op.n, op.l);
+        op.layout = h.layout;
+        const char* a = op.map.data() + bin_offset(h, 0);
+        const char* b = op.map.data() + bin_offset(h, 1);
+        const size_t na = static_cast<size_t>(op.m) * op.n, nb = static_cast<size_t>(op.n) * op.l;
+        if (h.dtype == dtype_of<T> && thread_config().bind == Bind::none) {
+            op.A = reinterpret_cast<const T*>(a);
+            op.B = reinterpret_cast<const T*>(b);
+            return;
+        }
+        reserve_operands(op);
+        T* A = op.mem.template alloc<T>(na);
+        T* B = op.mem.template alloc<T>(nb);
+        if (h.dtype == dtype_of<T>) {
+            place_local(A, reinterpret_cast<const T*>(a), na);
+            place_local(B, reinterpret_cast<const T*>(b), nb);
+        } else if (h.dtype == kDtypeF32) {
+            std::copy(reinterpret_cast<const float*>(a), reinterpret_cast<const float*>(a) + na, A);
+            std::copy(reinterpret_cast<const float*>(b), reinterpret_cast<const float*>(b) + nb, B);
+        } else {
+            std::copy(reinterpret_cast<const double*>(a), reinterpret_cast<const double*>(a) + na, A);
+            std::copy(reinterpret_cast<const double*>(b), reinterpret_cast<const double*>(b) + nb, B);
         }
-        out << '\n';
+        op.A = A;
+        op.B = B;
+    } else {
+        const char* p = op.map.data();
+        const char* end = p + op.map.size();
+        parse_text_dims(p, end, op.m, op.n, op.l);
+        reserve_operands(op);
+        T* A = op.mem.template alloc<T>(static_cast<size_t>(op.m) * op.n);
+        T* B = op.mem.template alloc<T>(static_cast<size_t>(op.n) * op.l);
+        parse_text_matrices(p, end, op.m, op.n, op.l, A, B);
+        op.A = A;
+        op.B = B;
     }
 }
 
-int main(int argc, char** argv) {
-    try {
-        if (argc != 3) {
-            std::cerr << "Uso: " << argv[0] << " <input.txt> <output.txt>\n";
-            return 1;
+// Error relativo máximo de C (en layout_c) frente al producto en f64
+template <class Tc>
+static double relative_error_vs_f64(const std::string& in_path, bool bin_in, const Tc* C, uint8_t layout_c,
+                                    Stats& stats) {
+    Stopwatch sw;
+    Operands<double> ref;
+    load_operands(in_path, bin_in, ref);
+    const size_t ml = static_cast<size_t>(ref.m) * ref.l;
+    double* R = ref.mem.alloc<double>(ml);
+    gemm_layouts(ref.A, ref.layout, ref.B, ref.layout, R, layout_c, ref.m, ref.n, ref.l);
+
+    double max_diff = 0.0, max_ref = 0.0;
+    for (size_t i = 0; i < ml; ++i) {
+        max_diff = std::max(max_diff, std::abs(static_cast<double>(C[i]) - R[i]));
+        max_ref = std::max(max_ref, std::abs(R[i]));
+    }
+    stats.add("check", sw.seconds(), static_cast<double>(sizeof(double)) * (1.0 * ref.m * ref.n + 1.0 * ref.n * ref.l + 1.0 * ml),
+              2.0 * ref.m * ref.n * ref.l);
+    return max_ref > 0.0 ? max_diff / max_ref : max_diff;
+}
+
+// Un producto C = A*B con A, B en Tin y C en Tc (Tin != Tc => precisión mixta)
+template <class Tin, class Tc>
+static void run_single(const std::string& in_path, const std::string& out_path, bool bin_in, bool bin_out,
+                       bool check, int& m, int& n, int& l, Stats& stats) {
+    Operands<Tin> op;
+    Stopwatch sw_read;
+    load_operands(in_path, bin_in, op);
+    // En binario solo se mapea: el costo de E/S real aparece en la fase gemm
+    stats.add("read", sw_read.seconds(), static_cast<double>(op.map.size()));
+    m = op.m; n = op.n; l = op.l;
+
+    const double gemm_bytes = static_cast<double>(sizeof(Tin)) * (1.0 * m * n + 1.0 * n * l) +
+                              static_cast<double>(sizeof(Tc)) * m * l;
+    const double gemm_flops = 2.0 * m * n * l;
+
+    // C se escribe directamente en el archivo de salida mapeado (binario) o,
+    // en texto, en un buffer row-major (== C^T (l×m) en column-major)
+    MappedFile fout_map;
+    Tc* C = nullptr;
+    uint8_t layout_c = kLayoutRow;
+    if (bin_out) {
+        layout_c = op.layout;
+        BinHeader h = make_header(layout_c, 1, dtype_of<Tc>);
+        h.dims[0][0] = static_cast<uint64_t>(m);
+        h.dims[0][1] = static_cast<uint64_t>(l);
+        fout_map.create(out_path, bin_file_size(h));
+        std::memcpy(fout_map.data(), &h, sizeof(h));
+        C = reinterpret_cast<Tc*>(fout_map.data() + bin_offset(h, 0));
+    } else {
+        C = op.mem.template alloc<Tc>(static_cast<size_t>(m) * l);
+    }
+
+    Stopwatch sw_gemm;
+    if constexpr (std::is_same_v<Tin, Tc>) {
+        gemm_layouts(op.A, op.layout, op.B, op.layout, C, layout_c, m, n, l);
+        stats.add(std::is_same_v<Tc, float> ? "sgemm" : "dgemm", sw_gemm.seconds(), gemm_bytes, gemm_flops);
+    } else {
+        gemm_mixed(op.A, op.layout, op.B, op.layout, C, layout_c, m, n, l);
+        stats.add("mixed_gemm", sw_gemm.seconds(), gemm_bytes, gemm_flops);
+    }
+
+    if (check) {
+        const double err = relative_error_vs_f64(in_path, bin_in, C, layout_c, stats);
+        std::cout << "Error relativo máximo vs f64: " << err << "\n";
+        stats.set("max_rel_error", Stats::num(err));
+    }
+
+    Stopwatch sw_write;
+    if (bin_out) {
+        const double out_bytes = static_cast<double>(fout_map.size());
+        fout_map.close(); // desmapea: el SO vuelca las páginas de C
+        stats.add("write", sw_write.seconds(), out_bytes);
+    } else {
+        std::ofstream fout(out_path);
+        if (!fout) throw std::runtime_error("No se pudo abrir el archivo de salida: " + out_path);
+        write_matrix_row_major(fout, C, m, l);
+        fout.flush();
+        stats.add("write", sw_write.seconds(), static_cast<double>(fout.tellp()));
+    }
+}
+
+// -----------------------------
+// Modo --pipeline: lectura, DGEMM y escritura solapadas
+//
+// En el modo normal las fases van una detrás de otra: parsear A y B, DGEMM,
+// formatear y escribir C. Con --pipeline:
+// - B se parsea por paneles de filas en un hilo lector. Cada panel listo
+//   pasa por una cola y DGEMM acumula C += A[:, k0:k1] * B[k0:k1, :]
+//   mientras el lector sigue con el siguiente.
+// - El último panel se aplica por bloques de filas de C. Cada bloque
+//   terminado pasa a un hilo escritor, que lo formatea y escribe mientras
+//   DGEMM calcula el siguiente.
+// Así el tiempo total tiende a max(E/S, cómputo) en vez de la suma. A se
+// parsea antes, porque todas las filas de C la necesitan completa. Con la
+// entrada binaria, A y B ya están en el mapeo (un solo panel); con la salida
+// binaria, C se escribe en el mapeo y no hay escritor.
+//
+// C sale de varias llamadas a DGEMM (paneles de B, bloques de filas), así
+// que puede diferir en el último bit del resultado de una sola, como con
+// --tile. Si el texto no tiene una fila por línea, se parsea entero como en
+// el modo normal (sin solapar la lectura).
+// -----------------------------
+static constexpr int    kPipelinePanels  = 8;   // paneles de B (como máximo)
+static constexpr int    kPipelineMinK    = 256; // filas de B por panel (mínimo)
+static constexpr int    kPipelineBlocks  = 16;  // bloques de filas de C del último panel
+static constexpr int    kPipelineMinRows = 64;
+static constexpr size_t kPipelineDepth   = 2;   // paneles listos en la cola / tandas en vuelo
+
+template <class T>
+static void run_pipelined(const std::string& in_path, const std::string& out_path, bool bin_in, bool bin_out,
+                          int& m, int& n, int& l, Stats& stats) {
+    Operands<T> op;
+    Stopwatch sw_read;
+    std::vector<const char*> lines; // inicio de cada fila de A y B en el texto
+    const char* body = nullptr;
+    const char* text_end = nullptr;
+    T* A_text = nullptr;
+    T* B_text = nullptr;
+    if (bin_in) {
+        load_operands(in_path, true, op);
+    } else {
+        op.map.open_read(in_path);
+        body = op.map.data();
+        text_end = body + op.map.size();
+        parse_text_dims(body, text_end, op.m, op.n, op.l);
+        reserve_operands(op);
+        A_text = op.mem.template alloc<T>(static_cast<size_t>(op.m) * op.n);
+        B_text = op.mem.template alloc<T>(static_cast<size_t>(op.n) * op.l);
+        op.A = A_text;
+        op.B = B_text;
+        if (!index_text_lines(body, text_end, static_cast<size_t>(op.m) + op.n, lines) ||
+            !parse_text_rows(lines[0], lines[static_cast<size_t>(op.m)], TextBlock<T>{op.m, op.n, A_text})) {
+            lines.clear();
+            parse_text_matrices(body, text_end, op.m, op.n, op.l, A_text, B_text);
         }
+    }
+    m = op.m; n = op.n; l = op.l;
+    stats.add("read", sw_read.seconds(), static_cast<double>(lines.empty() ? op.map.size() : lines[static_cast<size_t>(m)] - op.map.data()));
+
+    const bool paneled = !lines.empty();
+    const int K = paneled ? std::max(kPipelineMinK, (n + kPipelinePanels - 1) / kPipelinePanels) : n;
+    const int panels = (n + K - 1) / K;
+    const int R = std::max(kPipelineMinRows, (m + kPipelineBlocks - 1) / kPipelineBlocks);
 
-        const std::string in_path  = argv[1];
-        const std::string out_path = argv[2];
+    MappedFile fout_map;
+    T* C = nullptr;
+    uint8_t layout_c = kLayoutRow;
+    if (bin_out) {
+        layout_c = op.layout;
+        BinHeader h = make_header(layout_c, 1, dtype_of<T>);
+        h.dims[0][0] = static_cast<uint64_t>(m);
+        h.dims[0][1] = static_cast<uint64_t>(l);
+        fout_map.create(out_path, bin_file_size(h));
+        std::memcpy(fout_map.data(), &h, sizeof(h));
+        C = reinterpret_cast<T*>(fout_map.data() + bin_offset(h, 0));
+    } else {
+        C = op.mem.template alloc<T>(static_cast<size_t>(m) * l);
+    }
 
-        std::ifstream fin(in_path);
-        if (!fin) throw std::runtime_error("No se pudo abrir el archivo de entrada: " + in_path);
+    BlockingQueue<int> ready(kPipelineDepth);                            // paneles de B parseados
+    BlockingQueue<std::pair<int, int>> done(static_cast<size_t>(kPipelineBlocks)); // filas de C terminadas
+    bool parse_failed = false;
+    double t_parse = 0.0, t_write = 0.0, bytes_out = 0.0;
+    std::exception_ptr write_error;
 
-        // Leer dimensiones generales
-        int m = 0, n = 0, l = 0;
-        if (!(fin >> m >> n >> l) || m <= 0 || n <= 0 || l <= 0) {
-            throw std::runtime_error("Dimensiones inválidas. Se espera: m n l (enteros positivos).");
+    // 1) Lector: paneles de B
+    std::thread reader([&] {
+        for (int k = 0; k < panels; ++k) {
+            if (paneled) {
+                const int k0 = k * K, k1 = std::min(n, k0 + K);
+                const char* e = k1 < n ? lines[static_cast<size_t>(m) + k1] : text_end;
+                Stopwatch sw;
+                const bool ok = parse_text_rows(lines[static_cast<size_t>(m) + k0], e,
+                                                TextBlock<T>{k1 - k0, l, B_text + static_cast<size_t>(k0) * l});
+                t_parse += sw.seconds();
+                if (!ok) {
+                    parse_failed = true;
+                    break;
+                }
+            }
+            ready.push(k);
+        }
+        ready.close();
+    });
+
+    // 3) Escritor (salida de texto): abre el archivo con el primer bloque,
+    // así un error de lectura no deja una salida a medias
+    std::thread writer;
+    if (!bin_out) {
+        writer = std::thread([&] {
+            std::ofstream fout;
+            for (std::pair<int, int> rows; done.pop(rows);) {
+                if (write_error) continue;
+                Stopwatch sw;
+                try {
+                    if (!fout.is_open()) {
+                        fout.open(out_path);
+                        if (!fout) throw std::runtime_error("No se pudo abrir el archivo de salida: " + out_path);
+                        fout << m << " " << l << "\n";
+                    }
+                    write_rows_row_major(fout, C, rows.first, rows.second, l);
+                    if (rows.second == m) {
+                        fout.flush();
+                        bytes_out = static_cast<double>(fout.tellp());
+                    }
+                } catch (...) {
+                    write_error = std::current_exception();
+                }
+                t_write += sw.seconds();
+            }
+        });
+    }
+
+    // 2) Cómputo en este hilo
+    double t_gemm = 0.0;
+    for (int k; ready.pop(k);) {
+        const int k0 = k * K, k1 = std::min(n, k0 + K);
+        const T beta = k0 == 0 ? T(0) : T(1);
+        Stopwatch sw;
+        if (k1 < n) {
+            gemm_panel(op.A, op.layout, op.B, op.layout, C, layout_c, m, n, l, k0, k1, beta);
+        } else {
+            for (int i0 = 0; i0 < m; i0 += R) {
+                const int i1 = std::min(m, i0 + R);
+                gemm_block(op.A, op.layout, op.B, op.layout, C, layout_c, m, n, l, i0, i1, k0, k1, beta);
+                if (!bin_out) done.push({i0, i1});
+            }
+        }
+        t_gemm += sw.seconds();
+    }
+    done.close();
+    reader.join();
+    if (writer.joinable()) writer.join();
+
+    if (parse_failed) {
+        if (bin_out) {
+            fout_map.close();
+            std::filesystem::remove(out_path);
         }
+        // El parseo secuencial reproduce el mensaje de error con la posición
+        parse_text_matrices(body, text_end, m, n, l, A_text, B_text);
+        throw std::runtime_error("Error leyendo la matriz B.");
+    }
+    if (write_error) std::rethrow_exception(write_error);
+
+    const double b_bytes = paneled ? static_cast<double>(text_end - lines[static_cast<size_t>(m)]) : 0.0;
+    if (paneled) stats.add("parse_b", t_parse, b_bytes);
+    stats.add(std::is_same_v<T, float> ? "sgemm" : "dgemm", t_gemm,
+              static_cast<double>(sizeof(T)) * (1.0 * m * n + 1.0 * n * l + 1.0 * m * l), 2.0 * m * n * l);
+    if (bin_out) {
+        Stopwatch sw_write;
+        bytes_out = static_cast<double>(fout_map.size());
+        fout_map.close();
+        t_write = sw_write.seconds();
+    }
+    stats.add("write", t_write, bytes_out);
+    stats.set("pipeline", "true");
+    stats.set("panels", std::to_string(panels));
+    stats.set("row_blocks", std::to_string((m + R - 1) / R));
+}
 
-        // Leer A (m×n) y B (n×l)
-        const auto A_rm = read_matrix_row_major(fin, m, n, "A");
-        const auto B_rm = read_matrix_row_major(fin, n, l, "B");
+// -----------------------------
+// Modo batch: muchos problemas "m n l / A / B" seguidos en una sola entrada
+//
+// La entrada (archivo o "-" = stdin) se procesa por tandas. Los problemas
+// pequeños de cada tanda se agrupan; los grupos se reparten entre hilos con
+// BLAS en un solo hilo (o se despachan con cblas_dgemm_batch si se compila
+// con -DMCS_HAVE_DGEMM_BATCH). Los problemas grandes se resuelven después,
+// uno a uno, con todos los hilos de BLAS. Los resultados "m l / C" se
+// escriben en el orden de entrada.
+//
+// A, B y C de la tanda salen de una arena (arena.hpp) que se vacía entre
+// tandas: C no se rellena con ceros (DGEMM con beta = 0 la sobrescribe) y
+// desde la segunda tanda no se pide memoria ni hay fallos de página.
+// -----------------------------
+static constexpr size_t kBatchChunkBytes    = size_t{64} << 20; // datos por tanda
+static constexpr size_t kBatchMaxProblems   = 65536;
+static constexpr size_t kBatchReadBytes     = size_t{1} << 20;
+static constexpr double kSmallProblemFlops  = 64.0 * 64.0 * 64.0; // m*n*l
+static constexpr double kBatchGroupFlops    = 1 << 20;
 
-        // Convertir a column-major para DGEMM (Fortran)
-        const auto A = to_col_major(A_rm, m, n);
-        const auto B = to_col_major(B_rm, n, l);
+struct BatchProblem {
+    int m, n, l;
+    double *a, *b, *c; // en la arena de la tanda
+};
 
-        // C es (m×l) en column-major
-        std::vector<double> C(static_cast<size_t>(m) * l, 0.0);
+// Fuente de texto para el modo batch: archivo mapeado o stdin por bloques
+class BatchSource {
+public:
+    explicit BatchSource(const std::string& path) {
+        if (path == "-") {
+            from_stdin_ = true;
+            eof_ = false;
+        } else {
+            map_.open_read(path);
+            begin_ = map_.data();
+            end_ = begin_ + map_.size();
+        }
+    }
 
-        // DGEMM parámetros:
-        // A: (m×n), B: (n×l), C: (m×l)
-        const char trans = 'N';
-        const int M = m;
-        const int N = l;
-        const int K = n;
+    const char* begin() const { return begin_; }
+    const char* end() const { return end_; }
+    bool eof() const { return eof_; }
 
-        // Leading dimensions en column-major = número de filas del arreglo físico
-        const int lda = m; // A tiene m filas
-        const int ldb = n; // B tiene n filas
-        const int ldc = m; // C tiene m filas
+    // Descarta lo consumido (hasta p) y lee más de stdin
+    void refill(const char* p) {
+        if (!from_stdin_ || eof_) return;
+        const size_t keep = static_cast<size_t>(end_ - p);
+        if (keep > 0) std::memmove(buf_.data(), p, keep);
+        buf_.resize(keep + kBatchReadBytes);
+        std::cin.read(buf_.data() + keep, static_cast<std::streamsize>(kBatchReadBytes));
+        const size_t got = static_cast<size_t>(std::cin.gcount());
+        if (got < kBatchReadBytes) eof_ = true;
+        buf_.resize(keep + got);
+        begin_ = buf_.data();
+        end_ = begin_ + buf_.size();
+    }
 
-        const double alpha = 1.0;
-        const double beta  = 0.0;
+private:
+    MappedFile map_;
+    std::vector<char> buf_;
+    const char* begin_ = nullptr;
+    const char* end_ = nullptr;
+    bool from_stdin_ = false;
+    bool eof_ = true;
+};
 
-        dgemm_(&trans, &trans,
-               &M, &N, &K,
-               &alpha,
-               A.data(), &lda,
-               B.data(), &ldb,
-               &beta,
-               C.data(), &ldc);
+enum class BatchStatus { ok, need_more, end_of_input };
 
-        // Convertir C a row-major para escribir “normal”
-        const auto C_rm = to_row_major(C, m, l);
+// Extrae el token siguiente; need_more si puede continuar en el próximo bloque
+static BatchStatus next_token(const char*& p, const char* end, bool eof, const char*& tok_end) {
+    while (p < end && is_space(*p)) ++p;
+    if (p == end) return eof ? BatchStatus::end_of_input : BatchStatus::need_more;
+    tok_end = p;
+    while (tok_end < end && !is_space(*tok_end)) ++tok_end;
+    if (tok_end == end && !eof) return BatchStatus::need_more;
+    return BatchStatus::ok;
+}
 
-        std::ofstream fout(out_path);
+// Parsea un problema completo en data; en need_more / end_of_input no consume nada
+static BatchStatus parse_batch_problem(const char*& p_io, const char* end, bool eof, size_t index,
+                                       Arena& arena, BatchProblem& pb) {
+    const char* p = p_io;
+    const char* tok_end = nullptr;
+    int dims[3];
+    for (int d = 0; d < 3; ++d) {
+        const BatchStatus st = next_token(p, end, eof, tok_end);
+        if (st == BatchStatus::end_of_input && d == 0) return st;
+        if (st == BatchStatus::need_more) return st;
+        const char* q = p;
+        if (st == BatchStatus::ok && q < tok_end && *q == '+') ++q;
+        if (st != BatchStatus::ok || std::from_chars(q, tok_end, dims[d]).ec != std::errc{} || dims[d] <= 0) {
+            throw std::runtime_error("Dimensiones inválidas en el problema " + std::to_string(index) +
+                                     ". Se espera: m n l (enteros positivos).");
+        }
+        p = tok_end;
+    }
+
+    const Arena::Mark base = arena.mark();
+    pb = {dims[0], dims[1], dims[2], nullptr, nullptr, nullptr};
+    pb.a = arena.alloc<double>(static_cast<size_t>(pb.m) * pb.n);
+    pb.b = arena.alloc<double>(static_cast<size_t>(pb.n) * pb.l);
+    pb.c = arena.alloc<double>(static_cast<size_t>(pb.m) * pb.l);
+
+    const struct { double* data; int rows, cols; const char* name; } mats[2] = {
+        {pb.a, pb.m, pb.n, "A"}, {pb.b, pb.n, pb.l, "B"}};
+    for (const auto& mt : mats) {
+        for (int i = 0; i < mt.rows; ++i) {
+            for (int j = 0; j < mt.cols; ++j) {
+                const BatchStatus st = next_token(p, end, eof, tok_end);
+                if (st == BatchStatus::need_more) {
+                    arena.rewind(base);
+                    return st;
+                }
+                double& v = mt.data[static_cast<size_t>(i) * mt.cols + j];
+                if (st != BatchStatus::ok || !parse_number(p, tok_end, v)) {
+                    throw std::runtime_error("Error leyendo matriz " + std::string(mt.name) + " del problema " +
+                                             std::to_string(index) + " en (" + std::to_string(i) + "," +
+                                             std::to_string(j) + ").");
+                }
+            }
+        }
+    }
+    p_io = p;
+    return BatchStatus::ok;
+}
+
+// Formatea "m l" + C de un problema al final de out
+static void append_result(std::vector<char>& out, const double* C, int m, int l) {
+    const size_t pos = out.size();
+    out.resize(pos + 2 * 12 + static_cast<size_t>(m) * l * (kMaxDoubleChars + 1));
+    char* p = out.data() + pos;
+    p = std::to_chars(p, p + 12, m).ptr;
+    *p++ = ' ';
+    p = std::to_chars(p, p + 12, l).ptr;
+    *p++ = '\n';
+    p += format_rows(p, C, 0, m, l);
+    out.resize(static_cast<size_t>(p - out.data()));
+}
+
+#ifdef MCS_HAVE_DGEMM_BATCH
+// Despacha los problemas pequeños con una sola llamada a cblas_dgemm_batch.
+// Cada problema es un grupo de tamaño 1 (las dimensiones pueden variar).
+static void dgemm_batch_small(const std::vector<BatchProblem>& probs, const std::vector<size_t>& idx) {
+    const size_t g = idx.size();
+    std::vector<CBLAS_TRANSPOSE> trans(g, CblasNoTrans);
+    std::vector<int> M(g), N(g), K(g), lda(g), ldb(g), ldc(g), size(g, 1);
+    std::vector<double> alpha(g, 1.0), beta(g, 0.0);
+    std::vector<const double*> A(g), B(g);
+    std::vector<double*> C(g);
+    for (size_t k = 0; k < g; ++k) {
+        const BatchProblem& pb = probs[idx[k]];
+        M[k] = pb.m; N[k] = pb.l; K[k] = pb.n;
+        lda[k] = pb.n; ldb[k] = pb.l; ldc[k] = pb.l;
+        A[k] = pb.a; B[k] = pb.b; C[k] = pb.c;
+    }
+    cblas_dgemm_batch(CblasRowMajor, trans.data(), trans.data(), M.data(), N.data(), K.data(),
+                      alpha.data(), A.data(), lda.data(), B.data(), ldb.data(),
+                      beta.data(), C.data(), ldc.data(), static_cast<int>(g), size.data());
+}
+#endif
+
+// Resuelve y formatea una tanda: el texto de cada problema, en orden
+static std::vector<std::vector<char>> solve_batch_chunk(const std::vector<BatchProblem>& probs, Stats& stats) {
+    const auto flops = [](const BatchProblem& pb) {
+        return static_cast<double>(pb.m) * pb.n * pb.l;
+    };
+
+    // Grupos consecutivos de problemas pequeños: [first, last)
+    std::vector<std::pair<size_t, size_t>> groups;
+    std::vector<size_t> large, small;
+    for (size_t k = 0; k < probs.size();) {
+        if (flops(probs[k]) > kSmallProblemFlops) {
+            large.push_back(k++);
+            continue;
+        }
+        const size_t first = k;
+        double acc = 0.0;
+        while (k < probs.size() && flops(probs[k]) <= kSmallProblemFlops && acc < kBatchGroupFlops) {
+            acc += flops(probs[k]);
+            small.push_back(k++);
+        }
+        groups.emplace_back(first, k);
+    }
+
+    // Salida formateada por problema (se concatena en orden al final)
+    std::vector<std::vector<char>> text(probs.size());
+    auto solve = [&](size_t k) {
+        const BatchProblem& pb = probs[k];
+        gemm_layouts(pb.a, kLayoutRow, pb.b, kLayoutRow, pb.c, kLayoutRow, pb.m, pb.n, pb.l);
+    };
+
+    Stopwatch sw_compute;
+
+    // 1) Problemas pequeños: BLAS en un hilo, un hilo nuestro por grupo
+    const int blas_threads = blas_get_num_threads();
+    blas_set_num_threads(1);
+    {
+        const unsigned hw = max_threads();
+        const unsigned nthreads = static_cast<unsigned>(std::min<size_t>(hw, std::max<size_t>(1, groups.size())));
+        std::atomic<size_t> next{0};
+#ifdef MCS_HAVE_DGEMM_BATCH
+        if (!small.empty()) dgemm_batch_small(probs, small);
+        auto worker = [&](unsigned w) {
+            if (nthreads > 1) bind_worker(w);
+            for (size_t g; (g = next.fetch_add(1)) < groups.size();)
+                for (size_t k = groups[g].first; k < groups[g].second; ++k)
+                    append_result(text[k], probs[k].c, probs[k].m, probs[k].l);
+        };
+#else
+        auto worker = [&](unsigned w) {
+            if (nthreads > 1) bind_worker(w);
+            for (size_t g; (g = next.fetch_add(1)) < groups.size();)
+                for (size_t k = groups[g].first; k < groups[g].second; ++k) {
+                    solve(k);
+                    append_result(text[k], probs[k].c, probs[k].m, probs[k].l);
+                }
+        };
+#endif
+        std::vector<std::thread> pool;
+        for (unsigned t = 1; t < nthreads; ++t) pool.emplace_back(worker, t);
+        worker(0);
+        for (auto& th : pool) th.join();
+    }
+    blas_set_num_threads(blas_threads);
+
+    // 2) Problemas grandes: uno a uno con todos los hilos de BLAS
+    for (size_t k : large) {
+        solve(k);
+        append_result(text[k], probs[k].c, probs[k].m, probs[k].l);
+    }
+
+    double flops_total = 0.0, bytes_total = 0.0;
+    for (const BatchProblem& pb : probs) {
+        flops_total += 2.0 * flops(pb);
+        bytes_total += static_cast<double>(sizeof(double)) * (1.0 * pb.m * pb.n + 1.0 * pb.n * pb.l + 1.0 * pb.m * pb.l);
+    }
+    // DGEMM y formateo de C van juntos en los hilos: se reportan como una fase
+    stats.add("dgemm_format", sw_compute.seconds(), bytes_total, flops_total);
+    return text;
+}
+
+// Escribe el texto de una tanda; devuelve los bytes escritos
+static double write_batch_text(const std::vector<std::vector<char>>& text, std::ostream& out) {
+    double bytes_out = 0.0;
+    for (const auto& t : text) {
+        out.write(t.data(), static_cast<std::streamsize>(t.size()));
+        bytes_out += static_cast<double>(t.size());
+    }
+    if (!out) throw std::runtime_error("Error escribiendo la salida del batch.");
+    return bytes_out;
+}
+
+// Lee la entrada del batch por tandas
+class BatchReader {
+public:
+    explicit BatchReader(const std::string& path) : src_(path), p_(src_.begin()), parsed_from_(p_) {}
+
+    // Parsea problemas en probs (memoria de arena) hasta llenar una tanda o
+    // terminar la entrada; true si la entrada terminó
+    bool next_chunk(Arena& arena, std::vector<BatchProblem>& probs) {
+        for (;;) {
+            BatchProblem pb{};
+            const BatchStatus st = parse_batch_problem(p_, src_.end(), src_.eof(), count_ + probs.size(), arena, pb);
+            if (st == BatchStatus::ok) {
+                probs.push_back(pb);
+                if (probs.size() < kBatchMaxProblems && arena.used() < kBatchChunkBytes) continue;
+            } else if (st == BatchStatus::need_more) {
+                bytes_in_ += static_cast<double>(p_ - parsed_from_);
+                src_.refill(p_);
+                p_ = parsed_from_ = src_.begin();
+                continue;
+            }
+            count_ += probs.size();
+            return st == BatchStatus::end_of_input;
+        }
+    }
+
+    size_t count() const { return count_; }
+    double bytes_in() const { return bytes_in_ + static_cast<double>(p_ - parsed_from_); }
+
+private:
+    BatchSource src_;
+    const char* p_;
+    const char* parsed_from_;
+    size_t count_ = 0;
+    double bytes_in_ = 0.0;
+};
+
+// Tanda en vuelo de --batch --pipeline: problemas en la arena `slot` y,
+// una vez resueltos, su texto
+struct BatchChunk {
+    size_t slot = 0;
+    std::vector<BatchProblem> probs;
+    std::vector<std::vector<char>> text;
+};
+
+// --batch --pipeline: un hilo lector parsea la tanda siguiente en la otra
+// arena (doble buffer) mientras este hilo resuelve la actual, y un hilo
+// escritor vuelca la anterior. La arena de una tanda vuelve al lector apenas
+// se formatea C (el texto ya no depende de ella).
+static void run_batch_pipelined(BatchReader& rd, std::ostream& out, Stats& stats) {
+    std::array<Arena, kPipelineDepth> arenas;
+    for (Arena& a : arenas) a.reserve(kBatchChunkBytes);
+    BlockingQueue<size_t> free_q(kPipelineDepth);
+    BlockingQueue<BatchChunk> parsed_q(kPipelineDepth), write_q(kPipelineDepth);
+    for (size_t i = 0; i < kPipelineDepth; ++i) free_q.push(i);
+    double t_parse = 0.0, t_write = 0.0, bytes_out = 0.0;
+    std::exception_ptr read_error, write_error;
+
+    std::thread reader([&] {
+        try {
+            for (bool last = false; !last;) {
+                BatchChunk ch;
+                if (!free_q.pop(ch.slot)) break;
+                arenas[ch.slot].reset();
+                Stopwatch sw;
+                last = rd.next_chunk(arenas[ch.slot], ch.probs);
+                t_parse += sw.seconds();
+                parsed_q.push(std::move(ch));
+            }
+        } catch (...) {
+            read_error = std::current_exception();
+        }
+        parsed_q.close();
+    });
+    std::thread writer([&] {
+        for (BatchChunk ch; write_q.pop(ch);) {
+            if (write_error) continue;
+            Stopwatch sw;
+            try {
+                bytes_out += write_batch_text(ch.text, out);
+            } catch (...) {
+                write_error = std::current_exception();
+            }
+            t_write += sw.seconds();
+        }
+    });
+
+    for (BatchChunk ch; parsed_q.pop(ch);) {
+        ch.text = solve_batch_chunk(ch.probs, stats);
+        free_q.push(ch.slot);
+        ch.probs.clear();
+        write_q.push(std::move(ch));
+    }
+    free_q.close();
+    write_q.close();
+    reader.join();
+    writer.join();
+    if (read_error) std::rethrow_exception(read_error);
+    if (write_error) std::rethrow_exception(write_error);
+
+    stats.add("parse", t_parse, rd.bytes_in());
+    stats.add("write", t_write, bytes_out);
+    stats.set("pipeline", "true");
+    size_t arena_bytes = 0;
+    bool huge = true;
+    for (const Arena& a : arenas) {
+        arena_bytes += a.capacity();
+        huge = huge && a.huge_pages();
+    }
+    stats.set("arena_bytes", std::to_string(arena_bytes));
+    stats.set("huge_pages", huge ? "true" : "false");
+}
+
+static size_t run_batch(const std::string& in_path, const std::string& out_path, bool pipeline, Stats& stats) {
+    BatchReader rd(in_path);
+    std::ofstream fout;
+    if (out_path != "-") {
+        fout.open(out_path);
         if (!fout) throw std::runtime_error("No se pudo abrir el archivo de salida: " + out_path);
+    }
+    std::ostream& out = (out_path == "-") ? std::cout : fout;
+
+    if (pipeline) {
+        run_batch_pipelined(rd, out, stats);
+        out.flush();
+        return rd.count();
+    }
+
+    std::vector<BatchProblem> probs;
+    Arena arena(kBatchChunkBytes);
+    double t_parse = 0.0;
+    for (bool last = false; !last;) {
+        Stopwatch sw_parse;
+        last = rd.next_chunk(arena, probs);
+        t_parse += sw_parse.seconds();
+        // Tanda completa (o fin de la entrada): resolver y escribir
+        const auto text = solve_batch_chunk(probs, stats);
+        Stopwatch sw_write;
+        const double bytes_out = write_batch_text(text, out);
+        stats.add("write", sw_write.seconds(), bytes_out);
+        probs.clear();
+        arena.reset();
+    }
+    out.flush();
+    stats.add("parse", t_parse, rd.bytes_in());
+    stats.set("arena_bytes", std::to_string(arena.capacity()));
+    stats.set("huge_pages", arena.huge_pages() ? "true" : "false");
+    return rd.count();
+}
+
+// -----------------------------
+// Modo --serve: trabajos kJobMultiply (A, B -> C)
+//
+// A (m×n) y B (n×l) llegan en un MCSM como el de la entrada binaria y C sale
+// con su dtype y layout; DGEMM (o SGEMM con f32) lee del payload y escribe
+// directamente en la respuesta. Con param = 1 y entradas f32, C se acumula
+// en f64 como --precision mixed.
+// -----------------------------
+static void serve_multiply(const JobFrame& req, const JobInput& in, JobOutput& out) {
+    if (req.op != kJobMultiply) throw unsupported_job(req);
+    in.expect(2, "A y B");
+    const int m = in.rows(0), n = in.cols(0), l = in.cols(1);
+    if (in.rows(1) != n) throw std::runtime_error("Dimensiones incompatibles: A es m×n y B debe ser n×l.");
+    const uint8_t lay = in.layout();
+    if (in.dtype() == kDtypeF64) {
+        out.shape(kDtypeF64, lay, {{m, l}});
+        gemm_layouts(in.matrix<double>(0), lay, in.matrix<double>(1), lay, out.matrix<double>(0), lay, m, n, l);
+    } else if (req.param == 1) {
+        out.shape(kDtypeF64, lay, {{m, l}});
+        gemm_mixed(in.matrix<float>(0), lay, in.matrix<float>(1), lay, out.matrix<double>(0), lay, m, n, l);
+    } else {
+        out.shape(kDtypeF32, lay, {{m, l}});
+        gemm_layouts(in.matrix<float>(0), lay, in.matrix<float>(1), lay, out.matrix<float>(0), lay, m, n, l);
+    }
+}
 
-        write_matrix_row_major(fout, C_rm, m, l);
+int main(int argc, char** argv) {
+    try {
+        std::string out_format; // "" => igual que la entrada
+        bool to_bin = false;
+        bool batch = false;
+        bool pipeline = false; // --pipeline: lectura, cómputo y escritura solapadas
+        int tile = 0; // > 0 => modo out-of-core
+        Precision precision = Precision::f64;
+        uint8_t bin_layout = kLayoutRow; // layout de --to-bin
+        bool check = false;
+        std::string serve_addr; // --serve: unix:RUTA o tcp:HOST:PUERTO
+        const char* stats_env = std::getenv("MCS_STATS");
+        bool stats_on = stats_env && *stats_env && std::string(stats_env) != "0";
+        std::vector<std::string> args;
+        for (int i = 1; i < argc; ++i) {
+            const std::string a = argv[i];
+            if (a == "--to-bin") {
+                to_bin = true;
+            } else if (a == "--batch") {
+                batch = true;
+            } else if (a == "--pipeline") {
+                pipeline = true;
+            } else if (a == "--stats") {
+                stats_on = true;
+            } else if (a == "--layout" && i + 1 < argc) {
+                const std::string v = argv[++i];
+                if (v == "row") bin_layout = kLayoutRow;
+                else if (v == "col") bin_layout = kLayoutCol;
+                else throw std::runtime_error("--layout debe ser row o col.");
+            } else if (a == "--check") {
+                check = true;
+            } else if (a == "--precision" && i + 1 < argc) {
+                const std::string v = argv[++i];
+                if (v == "f64") precision = Precision::f64;
+                else if (v == "f32") precision = Precision::f32;
+                else if (v == "mixed") precision = Precision::mixed;
+                else throw std::runtime_error("--precision debe ser f32, f64 o mixed.");
+            } else if (a == "--tile" && i + 1 < argc) {
+                tile = std::atoi(argv[++i]);
+                if (tile <= 0) throw std::runtime_error("--tile debe ser un entero positivo.");
+            } else if (a == "--serve" && i + 1 < argc) {
+                serve_addr = argv[++i];
+            } else if (runtime_option(argc, argv, i) || serve_option(argc, argv, i)) {
+            } else if (a == "--out-format" && i + 1 < argc) {
+                out_format = argv[++i];
+                if (out_format != "txt" && out_format != "bin")
+                    throw std::runtime_error("--out-format debe ser txt o bin.");
+            } else {
+                args.push_back(a);
+            }
+        }
+
+        if (!serve_addr.empty()) {
+            if (!args.empty() || to_bin || batch || pipeline || tile > 0 || check || precision != Precision::f64 ||
+                !out_format.empty())
+                throw std::runtime_error("--serve solo admite las opciones de ejecución (la precisión va en cada trabajo).");
+            apply_runtime();
+            serve(serve_addr, serve_multiply);
+            return 0;
+        }
+        if (serve_config().max_payload_set) throw std::runtime_error("--max-payload requiere --serve.");
+
+        if (args.size() != 2) {
+            std::cerr << "Uso: " << argv[0] << " [--stats] [--out-format txt|bin] [--precision f64|f32|mixed] [--check]"
+                         " [--pipeline] <input> <output>\n"
+                      << "     " << argv[0] << " --to-bin [--precision f32] [--layout row|col] <input.txt> <input.bin>\n"
+                      << "     " << argv[0] << " --batch [--pipeline] <input.txt|-> <output.txt|->\n"
+                      << "     " << argv[0] << " --tile T <input.bin> <output.bin>\n"
+                      << "     " << argv[0] << " --serve unix:RUTA|tcp:HOST:PUERTO [--max-payload MiB]\n"
+                      << "  (todos los modos) " << kRuntimeUsage << "\n";
+            return 1;
+        }
+        apply_runtime();
+
+        const std::string in_path  = args[0];
+        const std::string out_path = args[1];
+        Stats stats(stats_on);
+        stats.set("tool", "\"matmul\"");
+        runtime_stats(stats);
+
+        if (to_bin) {
+            // mixed también guarda A y B en f32
+            if (precision == Precision::f64) convert_text_to_bin<double>(in_path, out_path, bin_layout);
+            else convert_text_to_bin<float>(in_path, out_path, bin_layout);
+            return 0;
+        }
+
+        if ((batch || tile > 0) && (precision != Precision::f64 || check))
+            throw std::runtime_error("--precision y --check solo se admiten en el modo de un producto (sin --batch ni --tile).");
+        if (pipeline && (tile > 0 || check || precision == Precision::mixed))
+            throw std::runtime_error("--pipeline no se combina con --tile, --check ni --precision mixed.");
+
+        if (batch) {
+            stats.set("mode", "\"batch\"");
+            const size_t count = run_batch(in_path, out_path, pipeline, stats);
+            (out_path == "-" ? std::cerr : std::cout)
+                << "OK: " << count << " productos C = A*B con DGEMM (batch).\n";
+            stats.set("problems", std::to_string(count));
+            stats.print_json(std::cerr);
+            return 0;
+        }
+
+        const bool bin_in = is_binary_file(in_path);
+        const bool bin_out = out_format.empty() ? bin_in : (out_format == "bin");
+
+        if (tile > 0) {
+            if (!bin_in || !bin_out)
+                throw std::runtime_error("El modo out-of-core (--tile) requiere entrada y salida binarias (ver --to-bin).");
+            int m = 0, n = 0, l = 0;
+            run_out_of_core(in_path, out_path, tile, m, n, l, stats);
+            std::cout << "OK: C = A*B con DGEMM por bloques de " << tile << ". Dimensiones: ("
+                      << m << "x" << l << ")\n";
+            stats.set("mode", "\"tile\"");
+            stats.set("tile", std::to_string(tile));
+            stats.set("m", std::to_string(m));
+            stats.set("n", std::to_string(n));
+            stats.set("l", std::to_string(l));
+            stats.print_json(std::cerr);
+            return 0;
+        }
+
+        int m = 0, n = 0, l = 0;
+        const char* how = "DGEMM";
+        switch (precision) {
+        case Precision::f64:
+            if (pipeline) run_pipelined<double>(in_path, out_path, bin_in, bin_out, m, n, l, stats);
+            else run_single<double, double>(in_path, out_path, bin_in, bin_out, check, m, n, l, stats);
+            break;
+        case Precision::f32:
+            if (pipeline) run_pipelined<float>(in_path, out_path, bin_in, bin_out, m, n, l, stats);
+            else run_single<float, float>(in_path, out_path, bin_in, bin_out, check, m, n, l, stats);
+            how = "SGEMM";
+            break;
+        case Precision::mixed:
+            run_single<float, double>(in_path, out_path, bin_in, bin_out, check, m, n, l, stats);
+            how = "SGEMM por paneles y acumulación f64";
+            break;
+        }
 
-        std::cout << "OK: C = A*B con DGEMM. Dimensiones: (" << m << "x" << l << ")\n";
+        std::cout << "OK: C = A*B con " << how << ". Dimensiones: (" << m << "x" << l << ")\n";
+        stats.set("mode", bin_in ? "\"bin\"" : "\"txt\"");
+        stats.set("precision", precision == Precision::f64 ? "\"f64\"" : precision == Precision::f32 ? "\"f32\"" : "\"mixed\"");
+        stats.set("m", std::to_string(m));
+        stats.set("n", std::to_string(n));
+        stats.set("l", std::to_string(l));
+        stats.print_json(std::cerr);
         return 0;
 
     } catch (const std::exception& ex) {
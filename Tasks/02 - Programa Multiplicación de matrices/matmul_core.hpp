@@ -0,0 +1,89 @@
+// matmul_core.hpp
+// Piezas compartidas por main-multiplicacion.cpp, bench-multiplicacion.cpp y
+// los programas de ajuste. Lo genérico vive en la biblioteca común
+// include/mcs (en la raíz del repositorio):
+// - matrix.hpp   : Matrix<T, L> (vista con ld) y memoria alineada a 64 bytes
+// - arena.hpp    : Arena, buffers sin inicializar que se reutilizan entre problemas
+// - matrix_io.hpp: formato binario MCSM, archivos mapeados, texto rápido
+// - blas.hpp     : xgemm y gemm sobre vistas Matrix
+// - lapack.hpp   : gels / gesv / posv / gesvd / gesdd y lapack_check
+// - transpose.hpp: transpose / to_col_major / to_row_major por bloques
+// - stats.hpp    : Stats, tiempos por fase en una línea JSON (--stats)
+// - threads.hpp  : hilos de los pools y afinidad por ranura (--bind)
+// - runtime.hpp  : --threads / --bind / --backend y copia local al nodo
+// Aquí queda lo propio del producto: gemm_layouts con el layout de cada
+// operando leído de la cabecera (en tiempo de ejecución) y la precisión mixta.
+#pragma once
+
+#include "../../include/mcs/arena.hpp"
+#include "../../include/mcs/blas.hpp"
+#include "../../include/mcs/matrix.hpp"
+#include "../../include/mcs/matrix_io.hpp"
+#include "../../include/mcs/runtime.hpp"
+#include "../../include/mcs/stats.hpp"
+#include "../../include/mcs/transpose.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+// C[i0:i1, :] = A[i0:i1, k0:k1] * B[k0:k1, :] (+ beta*C) para cualquier
+// combinación de layouts (sin copias); con i0 = 0, i1 = m, k0 = 0, k1 = n
+// es el producto completo. Los layouts se pasan a tiempo de compilación y
+// los operandos son bloques de las vistas de A, B y C, así que todo termina
+// en la misma llamada a gemm.
+template <class T>
+inline void gemm_block(const T* A, uint8_t layout_a,
+                       const T* B, uint8_t layout_b,
+                       T* C, uint8_t layout_c,
+                       int m, int n, int l, int i0, int i1, int k0, int k1, T beta = T(0)) {
+    // beta = 0 => C no necesita inicializarse; beta = 1 => C += A*B
+    const int M = i1 - i0, K = k1 - k0;
+    with_layout(layout_a, [&](auto la) {
+        with_layout(layout_b, [&](auto lb) {
+            with_layout(layout_c, [&](auto lc) {
+                const Matrix<const T, decltype(la)::value> Av(A, m, n);
+                const Matrix<const T, decltype(lb)::value> Bv(B, n, l);
+                const Matrix<T, decltype(lc)::value> Cv(C, m, l);
+                gemm(T(1), Av.block(i0, k0, M, K), Bv.block(k0, 0, K, l), beta, Cv.block(i0, 0, M, l));
+            });
+        });
+    });
+}
+
+// C = A[:, k0:k1] * B[k0:k1, :] (+ beta*C): un panel de K columnas de A
+template <class T>
+inline void gemm_panel(const T* A, uint8_t layout_a,
+                       const T* B, uint8_t layout_b,
+                       T* C, uint8_t layout_c,
+                       int m, int n, int l, int k0, int k1, T beta = T(0)) {
+    gemm_block(A, layout_a, B, layout_b, C, layout_c, m, n, l, 0, m, k0, k1, beta);
+}
+
+// C = A*B (+ beta*C) para cualquier combinación de layouts (sin copias)
+template <class T>
+inline void gemm_layouts(const T* A, uint8_t layout_a,
+                         const T* B, uint8_t layout_b,
+                         T* C, uint8_t layout_c,
+                         int m, int n, int l, T beta = T(0)) {
+    gemm_panel(A, layout_a, B, layout_b, C, layout_c, m, n, l, 0, n, beta);
+}
+
+// Precisión mixta: A y B en float, C en double.
+// Cada panel de kMixedPanel columnas de A (filas de B) se multiplica con SGEMM
+// (acumulación en float solo dentro del panel) y se suma a C en double, así el
+// error de acumulación crece con el tamaño del panel y no con n.
+inline constexpr int kMixedPanel = 512;
+
+inline void gemm_mixed(const float* A, uint8_t layout_a,
+                       const float* B, uint8_t layout_b,
+                       double* C, uint8_t layout_c,
+                       int m, int n, int l) {
+    const size_t mn = static_cast<size_t>(m) * l;
+    AlignedBuffer<float> P(mn);
+    std::fill(C, C + mn, 0.0);
+    for (int k0 = 0; k0 < n; k0 += kMixedPanel) {
+        const int k1 = std::min(n, k0 + kMixedPanel);
+        gemm_panel(A, layout_a, B, layout_b, P.data(), layout_c, m, n, l, k0, k1);
+        for (size_t i = 0; i < mn; ++i) C[i] += static_cast<double>(P[i]);
+    }
+}
@@ -0,0 +1,141 @@
+// online_ls.hpp
+// Mínimos cuadrados incrementales (modo --online de los programas de ajuste).
+//
+// En vez de repetir el QR sobre las m muestras cada vez que llega una nueva,
+// se guarda solo el factor R (n×n, triangular superior) y z = Q^T y (n×1):
+//     min ||A θ - y||  <=>  R θ = z,  SSE = rss
+// Cada muestra nueva (fila φ^T, valor y) se incorpora con n rotaciones de
+// Givens que anulan φ contra la diagonal de R: O(n²) por muestra, sin
+// depender de m. Con factor de olvido λ < 1 se escalan R y z por √λ antes de
+// cada muestra (las muestras viejas pesan λ^edad).
+//
+// El estado puede partir vacío (R = 0) o sembrarse con el R de un QR previo
+// (p. ej. el que deja LAPACKE_dgels en el triángulo superior de A).
+#pragma once
+
+#include "batch_fit.hpp" // next_field, field_to_double
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+class OnlineLS {
+public:
+    explicit OnlineLS(int n, double forget = 1.0)
+        : n_(n), sqrt_lambda_(std::sqrt(forget)), lambda_(forget),
+          R_(static_cast<size_t>(n) * n, 0.0), z_(n, 0.0), row_(n, 0.0) {}
+
+    // Siembra con un QR previo: R (n×n, column-major, ld = ldr; solo se lee el
+    // triángulo superior), la solución θ y su SSE. z = R θ.
+    void seed(const double* R, int ldr, const double* theta, double rss, long long count) {
+        for (int j = 0; j < n_; ++j)
+            for (int i = 0; i <= j; ++i) r(i, j) = R[static_cast<size_t>(j) * ldr + i];
+        for (int i = 0; i < n_; ++i) {
+            double s = 0.0;
+            for (int j = i; j < n_; ++j) s += r(i, j) * theta[j];
+            z_[i] = s;
+        }
+        rss_ = rss;
+        count_ = count;
+    }
+
+    // Incorpora la muestra (phi[0..n), y) con rotaciones de Givens
+    void add(const double* phi, double y) {
+        if (lambda_ != 1.0) {
+            for (double& v : R_) v *= sqrt_lambda_;
+            for (double& v : z_) v *= sqrt_lambda_;
+            rss_ *= lambda_;
+        }
+        std::copy(phi, phi + n_, row_.begin());
+        for (int k = 0; k < n_; ++k) {
+            const double bk = row_[k];
+            if (bk == 0.0) continue;
+            const double ak = r(k, k);
+            const double h = std::hypot(ak, bk);
+            const double c = ak / h, s = bk / h;
+            r(k, k) = h;
+            for (int j = k + 1; j < n_; ++j) {
+                const double t = r(k, j);
+                r(k, j) = c * t + s * row_[j];
+                row_[j] = -s * t + c * row_[j];
+            }
+            const double t = z_[k];
+            z_[k] = c * t + s * y;
+            y = -s * t + c * y;
+        }
+        rss_ += y * y; // lo que queda de y tras anular φ es el residuo nuevo
+        ++count_;
+    }
+
+    // Resuelve R θ = z por sustitución hacia atrás; false si R aún es singular
+    // (menos de n muestras independientes)
+    bool solve(double* theta) const {
+        double dmax = 0.0;
+        for (int k = 0; k < n_; ++k) dmax = std::max(dmax, std::abs(r(k, k)));
+        const double tol = dmax * n_ * std::numeric_limits<double>::epsilon();
+        for (int k = n_ - 1; k >= 0; --k) {
+            if (!(std::abs(r(k, k)) > tol)) return false;
+            double s = z_[k];
+            for (int j = k + 1; j < n_; ++j) s -= r(k, j) * theta[j];
+            theta[k] = s / r(k, k);
+        }
+        return true;
+    }
+
+    int params() const { return n_; }
+    double rss() const { return rss_; }
+    long long count() const { return count_; }
+
+private:
+    double& r(int i, int j) { return R_[static_cast<size_t>(j) * n_ + i]; }
+    double r(int i, int j) const { return R_[static_cast<size_t>(j) * n_ + i]; }
+
+    int n_;
+    double sqrt_lambda_, lambda_;
+    std::vector<double> R_, z_, row_; // row_: fila de trabajo (sin reservas por muestra)
+    double rss_ = 0.0;
+    long long count_ = 0;
+};
+
+// Lee muestras "x,y" línea a línea (cada una se procesa en cuanto llega, sin
+// esperar a llenar un bloque) y llama fn(x, y)
+template <class Fn>
+inline void for_each_sample(std::istream& in, Fn&& fn) {
+    std::string line;
+    long long line_no = 0;
+    while (std::getline(in, line)) {
+        ++line_no;
+        const char* q = line.data();
+        const char* le = q + line.size();
+        const std::string_view fx = next_field(q, le);
+        if (fx.empty() || fx.front() == '#') continue;
+        double x = 0.0, y = 0.0;
+        if (!field_to_double(fx, x) || !field_to_double(next_field(q, le), y)) {
+            if (line_no == 1) continue; // encabezado
+            throw std::runtime_error("Registro inválido en la línea " + std::to_string(line_no) + ". Se espera: x,y");
+        }
+        fn(x, y);
+    }
+}
+
+// Línea "count,θ_0,...,θ_{n-1},sse" (nan mientras R sea singular)
+inline void print_online_state(std::ostream& out, const OnlineLS& ls, std::vector<double>& theta) {
+    char buf[32];
+    std::string s = std::to_string(ls.count());
+    const bool ok = ls.solve(theta.data());
+    for (int k = 0; k < ls.params(); ++k) {
+        s += ',';
+        if (ok) s.append(buf, std::to_chars(buf, buf + sizeof(buf), theta[k]).ptr);
+        else s += "nan";
+    }
+    s += ',';
+    s.append(buf, std::to_chars(buf, buf + sizeof(buf), ls.rss()).ptr);
+    s += '\n';
+    out << s << std::flush;
+}
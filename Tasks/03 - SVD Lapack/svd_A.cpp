@@ -1,113 +1,1027 @@
+// svd_A.cpp
+// Descomposición en valores singulares A = U Σ V^T con LAPACK.
+//
+// Sin argumentos: la matriz 2×2 de la tarea, con la llamada original
+// (LAPACKE_dgesvd row-major, U y V^T completas), más la reconstrucción
+// U Σ V^T y su error.
+//
+// Con un archivo: cualquier matriz m×n en los formatos del programa de
+// multiplicación (Tarea 02), es decir, como su salida C:
+//   texto  : "filas columnas" y luego una fila por línea
+//   binario: MCSM con una sola matriz (f64 o f32, row- o column-major)
+// Por defecto se usa LAPACKE_dgesdd (divide y vencerás) en modo económico
+// ('S'): U es m×k y V^T es k×n con k = min(m, n); con --full, U es m×m y V^T
+// n×n. --driver gesvd usa el algoritmo QR clásico. U y V^T solo se calculan
+// si se van a escribir (--u, --vt) o imprimir (matrices de hasta kPrintMax).
+//
+// Con --rank k: SVD aleatorizada (Halko, Martinsson y Tropp) de los k primeros
+// tripletes: boceto gaussiano Y = A Ω con k + p columnas, q iteraciones de
+// potencia, Q = qr(Y), B = Q^T A y la SVD chica de B. Todo el trabajo pesado
+// son productos dgemm, O(m n (k + p)) en vez de O(m n min(m, n)); A solo se
+// lee (una entrada binaria f64 se usa directamente desde el mapeo). Se reporta
+// el error de la aproximación para elegir p y q.
+//
+// Con --update C: actualización incremental de Brand. Agrega las filas de C
+// a factores ya guardados (--s, --vt y opcionalmente --u) con una SVD chica
+// de (k + b)×(k + b) por bloque de b filas, y los reescribe.
+//
+// Con --cache DIR (SVD completa): los factores se guardan con el hash de A
+// como clave; si la misma A vuelve a llegar, se copian del archivo de la
+// caché y no se llama a LAPACK.
+//
+// Layout: LAPACK trabaja en column-major. Una A row-major (m×n) es, vista en
+// column-major, A^T (n×m); de A^T = U' Σ V'^T sale A = V' Σ U'^T, así que
+// U = V'^T y V^T = U'^T, que en column-major son justo U y V^T en row-major.
+// Por eso no se transpone nada: U y V^T salen en el layout de la entrada.
+//
+// Compilar (MSYS2 UCRT64):
+//   g++ -std=c++23 -O2 -Wall -Wextra svd_A.cpp -o svd_A.exe -llapacke -lopenblas
+//   (con --serve en Windows, agregar -lws2_32)
+//
+// Ejecutar:
+//   ./svd_A.exe                          (la matriz 2×2 de la tarea)
+//   ./svd_A.exe A.txt                    (valores singulares de A)
+//   ./svd_A.exe A.bin --u U.bin --vt VT.bin --s S.bin   (factores, en el formato de la entrada)
+//   ./svd_A.exe A.bin --out-format txt --s S.txt
+//   ./svd_A.exe A.bin --full --driver gesvd
+//   ./svd_A.exe A.bin --rank 20 --oversample 10 --power 2 --u U.bin
+//   ./svd_A.exe A.bin --cache cache/ --u U.bin   (reutiliza la SVD si A ya se factorizó)
+//   ./svd_A.exe --update C.bin --s S.bin --vt VT.bin --u U.bin   (agrega las filas de C)
+//   ./svd_A.exe --serve unix:/tmp/mcs-svd.sock   (servidor de SVD; ver server.hpp)
+//   ./svd_A.exe --stats A.bin            (o MCS_STATS=1): JSON por fase en stderr
+
 #include <iostream>
 #include <iomanip>
+#include <algorithm>
 #include <cmath>
-#include <lapacke.h>
-
-int main() {
-    // Matriz A en row-major: fila por fila
-    // A = [[1, -0.8],
-    //      [0,  1.0]]
-    double A[4] = {
-        1.0, -0.8,
-        0.0,  1.0
-    };
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <numbers>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
-    const lapack_int m = 2;
-    const lapack_int n = 2;
-    const lapack_int lda = n;
-
-    double S[2];    // valores singulares
-    double U[4];    // U (2x2)
-    double VT[4];   // V^T (2x2)
-    double superb[1];
-
-    // 1) SVD con LAPACKE
-    lapack_int info = LAPACKE_dgesvd(
-        LAPACK_ROW_MAJOR, // formato row-major
-        'A',              // calcular U completa
-        'A',              // calcular V^T completa
-        m, n,
-        A, lda,
-        S,
-        U, m,
-        VT, n,
-        superb
-    );
-
-    if (info != 0) {
-        std::cerr << "Error en dgesvd, info = " << info << '\n';
-        return 1;
+#include "../../include/mcs/blas.hpp"      // gemm
+#include "../../include/mcs/factor_cache.hpp" // FactorCache, hash_matrix
+#include "../../include/mcs/lapack.hpp"    // gesvd, gesdd, geqrf/orgqr, lapack_check (LAPACKE)
+#include "../../include/mcs/matrix_io.hpp" // MCSM, MappedFile, texto
+#include "../../include/mcs/runtime.hpp"   // --threads, --bind, --backend
+#include "../../include/mcs/server.hpp"    // --serve
+#include "../../include/mcs/stats.hpp"
+#include "../../include/mcs/transpose.hpp" // to_row_major
+
+// Hasta este tamaño se imprimen U, V^T y la reconstrucción
+static constexpr int kPrintMax = 8;
+
+// Verificación de U Σ V^T: bloques de A reconstruidos de a uno (2 MB)
+static constexpr int kCheckTileRows = 1024;
+static constexpr int kCheckTileCols = 256;
+
+// SVD aleatorizada: vectores de prueba e iteraciones de potencia para
+// estimar ||A - A_k||_2
+static constexpr int kErrorProbes = 10;
+static constexpr int kErrorPowerIters = 2;
+
+enum class Driver { gesdd, gesvd };
+
+// -----------------------------
+// Entrada
+//
+// A queda en un buffer propio (LAPACK la sobrescribe) en el layout del
+// archivo: el texto es row-major; el binario conserva el suyo (f32 se
+// amplía a f64). Con read_only (SVD aleatorizada, que no modifica A) un
+// binario f64 se lee directamente del mapeo, sin copia.
+// -----------------------------
+struct Input {
+    int m = 0, n = 0;
+    uint8_t layout = kLayoutRow;
+    bool binary = false;
+    MappedFile map;
+    AlignedBuffer<double> a;
+    const double* data = nullptr; // a.data() o el mapeo
+
+    size_t bytes() const { return static_cast<size_t>(m) * n * sizeof(double); }
+};
+
+static void load_matrix(const std::string& path, Input& in, bool read_only) {
+    MappedFile& f = in.map;
+    f.open_read(path);
+    in.binary = f.size() >= sizeof(kBinMagic) && std::memcmp(f.data(), kBinMagic, sizeof(kBinMagic)) == 0;
+    if (in.binary) {
+        const BinHeader& h = read_bin_matrix(f, in.m, in.n);
+        in.layout = h.layout;
+        const size_t count = static_cast<size_t>(in.m) * in.n;
+        const char* src = f.data() + bin_offset(h, 0);
+        if (read_only && h.dtype == kDtypeF64) {
+            in.data = reinterpret_cast<const double*>(src);
+            return;
+        }
+        in.a.resize(count);
+        in.data = in.a.data();
+        if (h.dtype == kDtypeF32) std::copy_n(reinterpret_cast<const float*>(src), count, in.a.data());
+        else std::memcpy(in.a.data(), src, count * sizeof(double));
+        f.close();
+        return;
     }
+    const char* p = f.data();
+    const char* end = p + f.size();
+    parse_text_shape(p, end, in.m, in.n);
+    in.a.resize(static_cast<size_t>(in.m) * in.n);
+    in.data = in.a.data();
+    parse_text_matrix(p, end, in.m, in.n, in.a.data());
+    f.close();
+}
 
-    std::cout << std::fixed << std::setprecision(8);
+// -----------------------------
+// Salida de un factor (rows×cols en el layout de A)
+//
+// Binario: el archivo MCSM se crea con su tamaño final y LAPACK escribe el
+// factor directamente en el mapeo. Texto: se calcula en un buffer y se
+// escribe al final (row-major, como la salida del producto).
+// -----------------------------
+class FactorOut {
+public:
+    void open(const std::string& path, int rows, int cols, uint8_t layout, bool binary) {
+        path_ = path;
+        rows_ = rows;
+        cols_ = cols;
+        layout_ = layout;
+        binary_ = binary && !path.empty();
+        if (binary_) {
+            BinHeader h = make_header(layout, 1);
+            h.dims[0][0] = static_cast<uint64_t>(rows);
+            h.dims[0][1] = static_cast<uint64_t>(cols);
+            map_.create(path, bin_file_size(h));
+            std::memcpy(map_.data(), &h, sizeof(h));
+            data_ = reinterpret_cast<double*>(map_.data() + bin_offset(h, 0));
+        } else {
+            buf_.resize(static_cast<size_t>(rows) * cols);
+            data_ = buf_.data();
+        }
+    }
 
-    std::cout << "Valores singulares S:\n";
-    for (int i = 0; i < 2; ++i)
-        std::cout << "  S[" << i << "] = " << S[i] << '\n';
+    double* data() const { return data_; }
 
-    std::cout << "\nMatriz U (2x2):\n";
-    for (int i = 0; i < m; ++i) {
-        for (int j = 0; j < m; ++j)
-            std::cout << std::setw(14) << U[i*n + j] << ' ';
-        std::cout << '\n';
+    // Bytes escritos
+    size_t finish() {
+        if (path_.empty()) return 0;
+        if (binary_) {
+            const size_t bytes = map_.size();
+            map_.close(); // desmapea: el SO vuelca las páginas
+            return bytes;
+        }
+        const double* rm = data_;
+        AlignedBuffer<double> tmp;
+        if (layout_ == kLayoutCol) {
+            tmp.resize(buf_.size());
+            to_row_major(data_, rows_, cols_, tmp.data());
+            rm = tmp.data();
+        }
+        std::ofstream out(path_);
+        if (!out) throw std::runtime_error("No se pudo abrir el archivo de salida: " + path_);
+        write_matrix_row_major(out, rm, rows_, cols_);
+        out.flush();
+        return static_cast<size_t>(out.tellp());
     }
 
-    std::cout << "\nMatriz V^T (2x2):\n";
-    for (int i = 0; i < n; ++i) {
-        for (int j = 0; j < n; ++j)
-            std::cout << std::setw(14) << VT[i*n + j] << ' ';
-        std::cout << '\n';
+private:
+    std::string path_;
+    int rows_ = 0, cols_ = 0;
+    uint8_t layout_ = kLayoutRow;
+    bool binary_ = false;
+    MappedFile map_;
+    AlignedBuffer<double> buf_;
+    double* data_ = nullptr;
+};
+
+// -----------------------------
+// SVD
+//
+// `job` es 'A' (completa), 'S' (económica) o 'N' (solo S). Para A row-major
+// se factoriza A^T en column-major e intercambian los papeles de U y V^T
+// (ver el comentario inicial).
+// -----------------------------
+static void svd_col_major(Driver driver, char job, Matrix<double> A, double* S, Matrix<double> U, Matrix<double> VT) {
+    if (driver == Driver::gesdd) {
+        lapack_check(gesdd(job, A, S, U, VT), "LAPACKE_dgesdd", "no convergió");
+    } else {
+        std::vector<double> superb(static_cast<size_t>(std::max(1, std::min(A.rows(), A.cols()) - 1)));
+        lapack_check(gesvd(job, job, A, S, U, VT, superb.data()), "LAPACKE_dgesvd", "no convergió");
     }
+}
 
-    // 2) Reconstruir A_rec = U * Sigma * V^T
-    double Sigma[4] = {0.0};
-    Sigma[0] = S[0];      // (0,0)
-    Sigma[3] = S[1];      // (1,1)
+template <Layout L>
+static void svd(Driver driver, char job, Matrix<double, L> A, double* S, Matrix<double, L> U, Matrix<double, L> VT) {
+    if constexpr (L == Layout::col) svd_col_major(driver, job, A, S, U, VT);
+    else svd_col_major(driver, job, A.transposed(), S, VT.transposed(), U.transposed());
+}
 
-    double US[4] = {0.0};
-    double A_rec[4] = {0.0};
+// -----------------------------
+// SVD aleatorizada (rango k, sobremuestreo p, q iteraciones de potencia)
+//
+// Con l = k + p columnas:
+//   Y = A Ω           (Ω n×l gaussiana)
+//   q veces:  Y <- A (A^T Y), reortonormalizando Y y A^T Y con QR
+//   Q = qr(Y)         (m×l, columnas ortonormales)
+//   B = Q^T A         (l×n) y su SVD chica B = Ũ Σ V^T
+//   U = Q Ũ           (solo las k primeras columnas)
+// Las iteraciones de potencia elevan los valores singulares a la 2q+1 y
+// separan el rango que interesa del resto cuando el espectro decae despacio.
+//
+// Error de A_k = U_k Σ_k V_k^T (= U_k U_k^T A):
+// - Frobenius, exacto: ||A - A_k||_F^2 = ||A||_F^2 - Σ_{i<k} σ_i^2. Por la
+//   resta, no baja de ~sqrt(eps)·||A||_F.
+// - Espectral, a posteriori: con r vectores gaussianos ω_i,
+//   ||A - A_k||_2 <= 10 sqrt(2/π) max_i ||(I - U_k U_k^T) A ω_i||
+//   con probabilidad 1 - 10^-r. Es holgada (con espectro plano se acerca a
+//   la de Frobenius), así que además se hacen unas iteraciones de potencia
+//   en bloque sobre (I - U_k U_k^T) A a partir de los mismos ω_i: dan una
+//   estimación por debajo, ajustada, de ||A - A_k||_2.
+// - σ_{k+1}(B) <= σ_{k+1}(A) <= ||A - A_k||_2, el error óptimo (si p > 0).
+//   Si la estimación espectral queda lejos de σ_{k+1}, conviene subir p o q.
+// -----------------------------
+struct RsvdParams {
+    int rank = 0, oversample = 10, power = 2;
+    uint64_t seed = 1;
+};
 
-    // US = U * Sigma
-    for (int i = 0; i < 2; ++i) {
-        for (int j = 0; j < 2; ++j) {
-            double sum = 0.0;
-            for (int k = 0; k < 2; ++k) {
-                sum += U[i*2 + k] * Sigma[k*2 + j];
-            }
-            US[i*2 + j] = sum;
-        }
+struct RsvdError {
+    double frob = 0.0, frob_rel = 0.0; // ||A - A_k||_F, y relativo a ||A||_F
+    double spec_bound = 0.0;           // cota probabilística de ||A - A_k||_2
+    double spec_est = 0.0;             // estimación (por debajo) de ||A - A_k||_2
+    double sigma_next = NAN;           // σ_{k+1} de B (NaN si p = 0)
+};
+
+static int sketch_cols(const RsvdParams& prm, int m, int n) {
+    return std::min(prm.rank + prm.oversample, std::min(m, n));
+}
+
+// Reemplaza las columnas de Y por una base ortonormal de su rango (Householder)
+static void orthonormalize(Matrix<double> Y, std::vector<double>& tau) {
+    tau.resize(static_cast<size_t>(std::max(1, Y.cols())));
+    lapack_check(geqrf(Y, tau.data()), "LAPACKE_dgeqrf");
+    lapack_check(orgqr(Y, tau.data()), "LAPACKE_dorgqr");
+}
+
+static void fill_gaussian(Matrix<double> X, std::mt19937_64& rng) {
+    std::normal_distribution<double> gauss;
+    for (int j = 0; j < X.cols(); ++j)
+        for (int i = 0; i < X.rows(); ++i) X(i, j) = gauss(rng);
+}
+
+// Normaliza cada columna de X; devuelve la mayor norma previa
+static double normalize_columns(Matrix<double> X) {
+    double max_norm = 0.0;
+    for (int j = 0; j < X.cols(); ++j) {
+        double s2 = 0.0;
+        for (int i = 0; i < X.rows(); ++i) s2 += X(i, j) * X(i, j);
+        const double nrm = std::sqrt(s2);
+        max_norm = std::max(max_norm, nrm);
+        if (nrm > 0.0)
+            for (int i = 0; i < X.rows(); ++i) X(i, j) /= nrm;
+    }
+    return max_norm;
+}
+
+// A column-major m×n (solo se lee); S: k valores; U m×k y VT k×n
+static RsvdError rsvd_col_major(const RsvdParams& prm, Matrix<const double> A, double* S,
+                                Matrix<double> U, Matrix<double> VT) {
+    const int m = A.rows(), n = A.cols(), k = prm.rank, l = sketch_cols(prm, m, n);
+    std::mt19937_64 rng(prm.seed);
+    std::vector<double> tau;
+
+    // Boceto e iteraciones de potencia
+    MatrixBuffer<double> Y(m, l), Z(n, l);
+    fill_gaussian(Z.view(), rng);
+    gemm(1.0, A, Z.view(), 0.0, Y.view());
+    for (int it = 0; it < prm.power; ++it) {
+        orthonormalize(Y.view(), tau);
+        gemm(1.0, A.transposed(), Y.view(), 0.0, Z.view()); // Z = A^T Y
+        orthonormalize(Z.view(), tau);
+        gemm(1.0, A, Z.view(), 0.0, Y.view());
+    }
+    orthonormalize(Y.view(), tau); // Y = Q
+
+    // B = Q^T A y su SVD chica (B se sobrescribe)
+    MatrixBuffer<double> B(l, n), Ub(l, l), VTb(l, n);
+    gemm(1.0, Y.view().transposed(), A, 0.0, B.view());
+    std::vector<double> Sb(static_cast<size_t>(l));
+    lapack_check(gesdd('S', B.view(), Sb.data(), Ub.view(), VTb.view()), "LAPACKE_dgesdd", "no convergió");
+
+    // U = Q Ũ_k, V^T = las k primeras filas de V^T de B
+    gemm(1.0, Matrix<const double>(Y.view()), Matrix<const double>(Ub.data(), l, k, l), 0.0, U);
+    const Matrix<const double> VTl = VTb.view();
+    for (int j = 0; j < n; ++j)
+        for (int i = 0; i < k; ++i) VT(i, j) = VTl(i, j);
+    std::copy_n(Sb.data(), k, S);
+
+    // Error
+    RsvdError err;
+    double a_norm2 = 0.0, s_norm2 = 0.0;
+    for (int j = 0; j < n; ++j)
+        for (int i = 0; i < m; ++i) a_norm2 += A(i, j) * A(i, j);
+    for (int i = 0; i < k; ++i) s_norm2 += S[i] * S[i];
+    err.frob = std::sqrt(std::max(0.0, a_norm2 - s_norm2));
+    err.frob_rel = a_norm2 > 0.0 ? err.frob / std::sqrt(a_norm2) : 0.0;
+    if (l > k) err.sigma_next = Sb[static_cast<size_t>(k)];
+
+    // P = (I - U U^T) A W, con W n×r gaussiana (la primera vez sin normalizar)
+    const int r = kErrorProbes;
+    MatrixBuffer<double> W(n, r), P(m, r), T(k, r);
+    const Matrix<const double> Uc = U;
+    auto project = [&] { // P <- (I - U U^T) P
+        gemm(1.0, Uc.transposed(), P.view(), 0.0, T.view());
+        gemm(-1.0, Uc, T.view(), 1.0, P.view());
+    };
+    fill_gaussian(W.view(), rng);
+    gemm(1.0, A, W.view(), 0.0, P.view());
+    project();
+    err.spec_bound = 10.0 * std::sqrt(2.0 / std::numbers::pi) * normalize_columns(P.view());
+
+    // Potencia en bloque con M = (I - U U^T) A: M^T P = A^T (I - U U^T) P.
+    // Cada ||M x|| (o ||M^T y||) con vector unitario es una cota inferior de
+    // ||M||_2. Se vuelve a proyectar P antes de A^T: si M es casi nula, P
+    // normalizada es puro redondeo y ya no está en el rango de I - U U^T.
+    for (int it = 0; it < kErrorPowerIters; ++it) {
+        project();
+        gemm(1.0, Matrix<const double>(P.view()).transposed(), A, 0.0, W.view().transposed());
+        err.spec_est = std::max(err.spec_est, normalize_columns(W.view()));
+        gemm(1.0, A, W.view(), 0.0, P.view());
+        project();
+        err.spec_est = std::max(err.spec_est, normalize_columns(P.view()));
+    }
+    return err;
+}
+
+template <Layout L>
+static RsvdError rsvd(const RsvdParams& prm, Matrix<const double, L> A, double* S,
+                      Matrix<double, L> U, Matrix<double, L> VT) {
+    if constexpr (L == Layout::col) return rsvd_col_major(prm, A, S, U, VT);
+    else return rsvd_col_major(prm, A.transposed(), S, VT.transposed(), U.transposed());
+}
+
+// Imprime una matriz chica con el formato de la tarea
+template <Layout L>
+static void print_matrix(const char* title, Matrix<const double, L> M) {
+    std::cout << "\n" << title << " (" << M.rows() << "x" << M.cols() << "):\n";
+    for (int i = 0; i < M.rows(); ++i) {
+        for (int j = 0; j < M.cols(); ++j)
+            std::cout << std::setw(14) << M(i, j) << ' ';
+        std::cout << '\n';
     }
+}
+
+// -----------------------------
+// Reconstrucción A_rec = U Σ V^T y su error frente a A
+//
+// Con k = S.size() (las k primeras columnas de U y filas de V^T). Σ no se
+// arma: por cada bloque de columnas se escala una copia de las filas de V^T
+// por S (O(k) por columna) y cada bloque de A_rec sale de un solo dgemm,
+// U(filas del bloque, :) · (Σ V^T)(:, columnas del bloque). El error máximo
+// y el de Frobenius se acumulan en la misma pasada, bloque a bloque, así que
+// no hace falta guardar A_rec entera (salvo que se pida, para imprimirla).
+// -----------------------------
+struct RecError {
+    double max_abs = 0.0;
+    double frob = 0.0, frob_rel = 0.0; // ||A - A_rec||_F, y relativo a ||A||_F
+};
 
-    // A_rec = US * V^T
-    for (int i = 0; i < 2; ++i) {
-        for (int j = 0; j < 2; ++j) {
-            double sum = 0.0;
-            for (int k = 0; k < 2; ++k) {
-                sum += US[i*2 + k] * VT[k*2 + j];
+static RecError reconstruction_error_col_major(Matrix<const double> A, const double* S, int k, Matrix<const double> U,
+                                               Matrix<const double> VT, Matrix<double> A_rec) {
+    const int m = A.rows(), n = A.cols();
+    const int tr = std::min(m, kCheckTileRows), tc = std::min(n, kCheckTileCols);
+    MatrixBuffer<double> SVT(k, tc), tile;
+    if (A_rec.size() == 0) tile.resize(tr, tc);
+
+    RecError e;
+    double err2 = 0.0, a2 = 0.0;
+    for (int j0 = 0; j0 < n; j0 += tc) {
+        const int c = std::min(tc, n - j0);
+        const Matrix<double> SV = SVT.view().block(0, 0, k, c);
+        for (int j = 0; j < c; ++j)
+            for (int p = 0; p < k; ++p) SV(p, j) = S[p] * VT(p, j0 + j);
+        for (int i0 = 0; i0 < m; i0 += tr) {
+            const int r = std::min(tr, m - i0);
+            const Matrix<double> R = A_rec.size() ? A_rec.block(i0, j0, r, c) : tile.view().block(0, 0, r, c);
+            gemm(1.0, U.block(i0, 0, r, k), Matrix<const double>(SV), 0.0, R);
+            for (int j = 0; j < c; ++j) {
+                for (int i = 0; i < r; ++i) {
+                    const double a = A(i0 + i, j0 + j), d = R(i, j) - a;
+                    e.max_abs = std::max(e.max_abs, std::fabs(d));
+                    err2 += d * d;
+                    a2 += a * a;
+                }
             }
-            A_rec[i*2 + j] = sum;
         }
     }
+    e.frob = std::sqrt(err2);
+    e.frob_rel = a2 > 0.0 ? e.frob / std::sqrt(a2) : 0.0;
+    return e;
+}
+
+// Para A row-major se reconstruye A^T = (V^T)^T Σ U^T en column-major
+template <Layout L>
+static RecError reconstruction_error(Matrix<const double, L> A, const double* S, int k, Matrix<const double, L> U,
+                                     Matrix<const double, L> VT, Matrix<double, L> A_rec = {}) {
+    if constexpr (L == Layout::col) return reconstruction_error_col_major(A, S, k, U, VT, A_rec);
+    else return reconstruction_error_col_major(A.transposed(), S, k, VT.transposed(), U.transposed(), A_rec.transposed());
+}
+
+// U, V^T, reconstrucción U Σ V^T y error máximo frente a A (solo matrices chicas)
+template <Layout L>
+static void print_small(Matrix<const double, L> A, const double* S, Matrix<const double, L> U, Matrix<const double, L> VT) {
+    print_matrix("Matriz U", U);
+    print_matrix("Matriz V^T", VT);
+
+    const int m = A.rows(), n = A.cols();
+    std::vector<double> rec(static_cast<size_t>(m) * n);
+    const Matrix<double, L> A_rec(rec.data(), m, n);
+    const RecError e = reconstruction_error(A, S, std::min(m, n), U, VT, A_rec);
 
     std::cout << "\nA reconstruida (U * Sigma * V^T):\n";
-    for (int i = 0; i < 2; ++i) {
-        for (int j = 0; j < 2; ++j)
-            std::cout << std::setw(14) << A_rec[i*2 + j] << ' ';
+    for (int i = 0; i < m; ++i) {
+        for (int j = 0; j < n; ++j)
+            std::cout << std::setw(14) << A_rec(i, j) << ' ';
         std::cout << '\n';
     }
+    std::cout << "\nError máximo |A_rec - A_orig| = " << e.max_abs << '\n';
+}
 
-    // 3) Error máximo respecto a la A original
-    double A_orig[4] = {
-        1.0, -0.8,
-        0.0,  1.0
-    };
+// -----------------------------
+// Actualización incremental (Brand) al agregar filas
+//
+// Con A ≈ U Σ V^T (rango k) y un bloque C de b filas nuevas:
+//   L = C V                 (b×k, coordenadas de C en el subespacio de V)
+//   H = C - L V^T           (lo que queda fuera; se proyecta dos veces)
+//   H^T = J K               (QR: J n×b ortonormal, K b×b)
+//   [A; C] ≈ [U 0; 0 I] · M · [V J]^T,   M = [Σ 0; L K^T]   ((k+b)×(k+b))
+// De la SVD chica M = Û Σ' V̂^T se toman los k primeros tripletes:
+//   Σ' (k valores),  V'^T = V̂^T(:k, :k) V^T + V̂^T(:k, k:) J^T,
+//   U' = [U Û(:k, :k); Û(k:, :k)]
+// Σ' y V'^T solo necesitan Σ, V^T y C: cuestan O(n k b + (k+b)^3), no
+// dependen de cuántas filas lleva A. U' sí toca las m filas de U; para no
+// rotarla una vez por bloque se acumula la rotación W (k×k) y las filas
+// nuevas Y, y al final U' = [U W; Y] con un solo dgemm.
+//
+// C se procesa en bloques de a lo sumo kUpdateBlock filas (y n, para que J
+// exista). El truncamiento a rango k pierde en cada bloque Σ'(k:), que se
+// reporta.
+// -----------------------------
+static constexpr int kUpdateBlock = 256;
+
+struct UpdateReport {
+    int blocks = 0, rows = 0;
+    double sigma_dropped = 0.0; // mayor σ descartado en un bloque
+    double frob_dropped = 0.0;  // sqrt(Σ de todos los σ descartados^2)
+    double novelty = 0.0;       // ||C - C V V^T||_F (antes de cada bloque)
+    double c_norm = 0.0;        // ||C||_F
+};
+
+struct UpdateState {
+    int k = 0, n = 0;
+    std::vector<double> S;
+    MatrixBuffer<double> VT; // k×n, column-major
+    MatrixBuffer<double> W;  // k×k: U' = [U W; Y]
+    MatrixBuffer<double> Y;  // filas nuevas × k
+
+    template <Layout L>
+    void init(const double* s, Matrix<const double, L> vt) {
+        k = vt.rows();
+        n = vt.cols();
+        S.assign(s, s + k);
+        VT.resize(k, n);
+        const Matrix<double> V = VT.view();
+        for (int j = 0; j < n; ++j)
+            for (int i = 0; i < k; ++i) V(i, j) = vt(i, j);
+        W.resize(k, k);
+        const Matrix<double> Wv = W.view();
+        for (int j = 0; j < k; ++j)
+            for (int i = 0; i < k; ++i) Wv(i, j) = i == j ? 1.0 : 0.0;
+        Y.resize(0, k);
+    }
+};
+
+static double frob_norm2(Matrix<const double> X) {
+    double s2 = 0.0;
+    for (int j = 0; j < X.cols(); ++j)
+        for (int i = 0; i < X.rows(); ++i) s2 += X(i, j) * X(i, j);
+    return s2;
+}
+
+// Un bloque de b filas nuevas (C: b×n, cualquier layout)
+template <Layout LC>
+static void brand_block(UpdateState& st, Matrix<const double, LC> C, UpdateReport& rep) {
+    const int k = st.k, n = st.n, b = C.rows(), kb = k + b;
+    const Matrix<const double> VT = st.VT.view();
+
+    // L = C V;  H = C - L V^T, dos veces (Gram-Schmidt clásico reiterado)
+    MatrixBuffer<double> L(b, k), L2(b, k);
+    MatrixBuffer<double, Layout::row> H(b, n); // H row-major = H^T column-major
+    const Matrix<double, Layout::row> Hv = H.view();
+    for (int i = 0; i < b; ++i)
+        for (int j = 0; j < n; ++j) Hv(i, j) = C(i, j);
+    rep.c_norm += frob_norm2(Matrix<const double>(Hv.transposed()));
+    gemm(1.0, C, VT.transposed(), 0.0, L.view());
+    gemm(-1.0, Matrix<const double>(L.view()), VT, 1.0, Hv);
+    gemm(1.0, Matrix<const double, Layout::row>(Hv), VT.transposed(), 0.0, L2.view());
+    gemm(-1.0, Matrix<const double>(L2.view()), VT, 1.0, Hv);
+    for (size_t i = 0; i < L.size(); ++i) L.data()[i] += L2.data()[i];
+    rep.novelty += frob_norm2(Matrix<const double>(Hv.transposed()));
+
+    // H^T = J K
+    const Matrix<double> Ht = Hv.transposed(); // n×b
+    std::vector<double> tau;
+    tau.resize(static_cast<size_t>(b));
+    lapack_check(geqrf(Ht, tau.data()), "LAPACKE_dgeqrf");
+    MatrixBuffer<double> M(kb, kb);
+    const Matrix<double> Mv = M.view();
+    std::fill(M.data(), M.data() + M.size(), 0.0);
+    for (int i = 0; i < k; ++i) Mv(i, i) = st.S[static_cast<size_t>(i)];
+    for (int j = 0; j < k; ++j)
+        for (int i = 0; i < b; ++i) Mv(k + i, j) = L.view()(i, j);
+    for (int j = 0; j < b; ++j)
+        for (int i = j; i < b; ++i) Mv(k + i, k + j) = Ht(j, i); // K^T (triangular inferior)
+    lapack_check(orgqr(Ht, tau.data()), "LAPACKE_dorgqr");     // Ht = J
+
+    // SVD chica de M
+    MatrixBuffer<double> Uh(kb, kb), VhT(kb, kb);
+    std::vector<double> Sh(static_cast<size_t>(kb));
+    lapack_check(gesdd('S', Mv, Sh.data(), Uh.view(), VhT.view()), "LAPACKE_dgesdd", "no convergió");
+    double dropped2 = 0.0;
+    for (int i = k; i < kb; ++i) dropped2 += Sh[static_cast<size_t>(i)] * Sh[static_cast<size_t>(i)];
+    rep.frob_dropped = std::sqrt(rep.frob_dropped * rep.frob_dropped + dropped2);
+    rep.sigma_dropped = std::max(rep.sigma_dropped, Sh[static_cast<size_t>(k)]);
+    std::copy_n(Sh.data(), k, st.S.data());
+
+    // V'^T = V̂^T(:k, :k) V^T + V̂^T(:k, k:) J^T
+    const Matrix<const double> Vh = VhT.view(), Uk = Uh.view().block(0, 0, k, k);
+    MatrixBuffer<double> VTn(k, n);
+    gemm(1.0, Vh.block(0, 0, k, k), VT, 0.0, VTn.view());
+    gemm(1.0, Vh.block(0, k, k, b), Matrix<const double>(Ht).transposed(), 1.0, VTn.view());
+    st.VT = std::move(VTn);
+
+    // W <- W Û(:k, :k);  Y <- [Y Û(:k, :k); Û(k:, :k)]
+    MatrixBuffer<double> Wn(k, k), Yn(st.Y.rows() + b, k);
+    gemm(1.0, Matrix<const double>(st.W.view()), Uk, 0.0, Wn.view());
+    const int a = st.Y.rows();
+    if (a > 0) gemm(1.0, Matrix<const double>(st.Y.view()), Uk, 0.0, Yn.view().block(0, 0, a, k));
+    for (int j = 0; j < k; ++j)
+        for (int i = 0; i < b; ++i) Yn.view()(a + i, j) = Uh.view()(k + i, j);
+    st.W = std::move(Wn);
+    st.Y = std::move(Yn);
+    ++rep.blocks;
+    rep.rows += b;
+}
 
-    double max_err = 0.0;
-    for (int i = 0; i < 4; ++i) {
-        double diff = std::fabs(A_rec[i] - A_orig[i]);
-        if (diff > max_err) max_err = diff;
+template <Layout LC>
+static UpdateReport brand_update(UpdateState& st, Matrix<const double, LC> C) {
+    if (C.cols() != st.n)
+        throw std::runtime_error("Las filas nuevas tienen " + std::to_string(C.cols()) +
+                                 " columnas; V^T tiene " + std::to_string(st.n) + ".");
+    UpdateReport rep;
+    const int step = std::min(kUpdateBlock, st.n);
+    for (int i0 = 0; i0 < C.rows(); i0 += step)
+        brand_block(st, C.block(i0, 0, std::min(step, C.rows() - i0), st.n), rep);
+    rep.c_norm = std::sqrt(rep.c_norm);
+    rep.novelty = std::sqrt(rep.novelty);
+    return rep;
+}
+
+// --update: lee S, V^T (y U) de sus archivos, agrega las filas de C y
+// reescribe los factores en su formato. Cada factor se escribe primero en
+// "<archivo>.tmp" y recién al final reemplaza al original: si algo falla a
+// mitad de camino, los factores de ayer quedan intactos.
+static void run_update(const std::string& c_path, const std::string& u_path, const std::string& vt_path,
+                       const std::string& s_path, Stats& stats) {
+    Stopwatch sw_read;
+    Input S_in, VT_in, U_in, C_in;
+    load_matrix(s_path, S_in, true);
+    load_matrix(vt_path, VT_in, true);
+    load_matrix(c_path, C_in, true);
+    const bool with_u = !u_path.empty();
+    if (with_u) load_matrix(u_path, U_in, true);
+    const int k = VT_in.m, n = VT_in.n;
+    if (std::min(S_in.m, S_in.n) != 1 || std::max(S_in.m, S_in.n) != k)
+        throw std::runtime_error("S debe ser un vector de " + std::to_string(k) + " valores (las filas de V^T).");
+    if (with_u && U_in.n != k)
+        throw std::runtime_error("U debe tener " + std::to_string(k) + " columnas (las filas de V^T).");
+    if (with_u && U_in.layout != VT_in.layout) throw std::runtime_error("U y V^T deben tener el mismo layout.");
+    stats.add("read", sw_read.seconds(),
+              static_cast<double>(S_in.bytes() + VT_in.bytes() + C_in.bytes() + U_in.bytes()));
+
+    std::cout << "Actualizacion incremental: " << C_in.m << " filas nuevas, n = " << n << ", rango k = " << k;
+    if (with_u) std::cout << ", A: " << U_in.m << " -> " << U_in.m + C_in.m << " filas";
+    std::cout << "\n";
+
+    Stopwatch sw_upd;
+    UpdateState st;
+    with_layout(VT_in.layout, [&](auto lt) {
+        st.init(S_in.data, Matrix<const double, decltype(lt)::value>(VT_in.data, k, n));
+    });
+    UpdateReport rep;
+    with_layout(C_in.layout, [&](auto lt) {
+        rep = brand_update(st, Matrix<const double, decltype(lt)::value>(C_in.data, C_in.m, C_in.n));
+    });
+    // Por fila nueva ~8 n k (L, H y la reproyección) + 2 n k (V'^T)
+    stats.add("brand", sw_upd.seconds(), static_cast<double>(C_in.bytes() + 2 * VT_in.bytes()),
+              10.0 * n * k * rep.rows);
+
+    // Factores nuevos en los .tmp
+    Stopwatch sw_write;
+    const int m = U_in.m;
+    FactorOut S_out, VT_out, U_out;
+    S_out.open(s_path + ".tmp", S_in.m, S_in.n, S_in.layout, S_in.binary);
+    std::copy(st.S.begin(), st.S.end(), S_out.data());
+    VT_out.open(vt_path + ".tmp", k, n, VT_in.layout, VT_in.binary);
+    with_layout(VT_in.layout, [&](auto lt) {
+        const Matrix<double, decltype(lt)::value> VT(VT_out.data(), k, n);
+        const Matrix<const double> src = st.VT.view();
+        for (int i = 0; i < k; ++i)
+            for (int j = 0; j < n; ++j) VT(i, j) = src(i, j);
+    });
+    if (with_u) {
+        U_out.open(u_path + ".tmp", m + rep.rows, k, U_in.layout, U_in.binary);
+        with_layout(U_in.layout, [&](auto lt) {
+            constexpr Layout L = decltype(lt)::value;
+            const Matrix<double, L> U(U_out.data(), m + rep.rows, k);
+            gemm(1.0, Matrix<const double, L>(U_in.data, m, k), Matrix<const double>(st.W.view()), 0.0,
+                 U.block(0, 0, m, k));
+            const Matrix<const double> Y = st.Y.view();
+            for (int i = 0; i < rep.rows; ++i)
+                for (int j = 0; j < k; ++j) U(m + i, j) = Y(i, j);
+        });
     }
-    std::cout << "\nError máximo |A_rec - A_orig| = " << max_err << '\n';
+    const size_t bytes = S_out.finish() + VT_out.finish() + U_out.finish();
+    S_in.map.close();
+    VT_in.map.close();
+    U_in.map.close();
+    std::filesystem::rename(s_path + ".tmp", s_path);
+    std::filesystem::rename(vt_path + ".tmp", vt_path);
+    if (with_u) std::filesystem::rename(u_path + ".tmp", u_path);
+    stats.add("write", sw_write.seconds(), static_cast<double>(bytes));
+
+    std::cout << std::fixed << std::setprecision(8) << "Valores singulares S:\n";
+    for (int i = 0; i < k; ++i)
+        std::cout << "  S[" << i << "] = " << st.S[static_cast<size_t>(i)] << '\n';
+    std::cout << std::scientific << std::setprecision(3)
+              << "Bloques: " << rep.blocks << " (de hasta " << std::min(kUpdateBlock, n) << " filas)\n"
+              << "  ||C||_F = " << rep.c_norm << ", fuera del subespacio de V_k: " << rep.novelty << "\n"
+              << "  descartado al truncar a rango k: sigma_max = " << rep.sigma_dropped
+              << ", Frobenius = " << rep.frob_dropped << "\n";
+    if (!with_u) std::cout << "  (sin --u: solo se actualizaron S y V^T)\n";
+
+    stats.set("n", std::to_string(n));
+    stats.set("rank", std::to_string(k));
+    stats.set("rows_added", std::to_string(rep.rows));
+}
 
-    return 0;
+// -----------------------------
+// Modo --serve: trabajos kJobSvd (A -> S, U, V^T)
+//
+// SVD económica de A (m×n, f64 o f32) con el driver de --driver; LAPACK
+// trabaja directamente sobre el payload (f64) o sobre su copia ampliada
+// (f32). Con param = 1 solo se calculan los valores singulares (job 'N');
+// cualquier otro valor (0, o -1 como en el resto del protocolo) es la SVD
+// completa.
+// Respuesta en el layout de A: S (k×1), U (m×k) y V^T (k×n), o solo S.
+// -----------------------------
+static void run_server(const std::string& addr, Driver driver) {
+    AlignedBuffer<double> wide; // A f32 ampliada
+    serve(addr, [&](const JobFrame& req, const JobInput& in, JobOutput& out) {
+        if (req.op != kJobSvd) throw unsupported_job(req);
+        in.expect(1, "A");
+        const int m = in.rows(0), n = in.cols(0), k = std::min(m, n);
+        if (k == 0) throw std::runtime_error("A no puede estar vacía.");
+        double* a = nullptr;
+        if (in.dtype() == kDtypeF32) {
+            wide.resize(static_cast<size_t>(m) * n);
+            std::copy_n(in.matrix<float>(0), wide.size(), wide.data());
+            a = wide.data();
+        } else {
+            a = in.matrix<double>(0);
+        }
+        const bool vectors = req.param != 1;
+        if (vectors) out.shape(kDtypeF64, in.layout(), {{k, 1}, {m, k}, {k, n}});
+        else out.shape(kDtypeF64, in.layout(), {{k, 1}});
+        with_layout(in.layout(), [&](auto lt) {
+            constexpr Layout L = decltype(lt)::value;
+            svd(driver, vectors ? 'S' : 'N', Matrix<double, L>(a, m, n), out.matrix<double>(0),
+                Matrix<double, L>(vectors ? out.matrix<double>(1) : nullptr, m, vectors ? k : 0),
+                Matrix<double, L>(vectors ? out.matrix<double>(2) : nullptr, vectors ? k : 0, n));
+        });
+    });
+}
+
+int main(int argc, char** argv) {
+    try {
+        std::string in_path, u_path, vt_path, s_path, update_path;
+        std::string cache_dir; // --cache: directorio de la caché de factorizaciones
+        std::string serve_addr; // --serve: unix:RUTA o tcp:HOST:PUERTO
+        std::string out_format; // "" => igual que la entrada
+        Driver driver = Driver::gesdd;
+        bool full = false, check = false;
+        RsvdParams rank_prm; // rank = 0 => SVD completa
+        const char* stats_env = std::getenv("MCS_STATS");
+        bool stats_on = stats_env && *stats_env && std::string(stats_env) != "0";
+        for (int i = 1; i < argc; ++i) {
+            const std::string a = argv[i];
+            if (a == "--driver" && i + 1 < argc) {
+                const std::string v = argv[++i];
+                if (v == "gesdd") driver = Driver::gesdd;
+                else if (v == "gesvd") driver = Driver::gesvd;
+                else throw std::runtime_error("--driver debe ser gesdd o gesvd.");
+            } else if (a == "--full") {
+                full = true;
+            } else if (a == "--u" && i + 1 < argc) {
+                u_path = argv[++i];
+            } else if (a == "--vt" && i + 1 < argc) {
+                vt_path = argv[++i];
+            } else if (a == "--s" && i + 1 < argc) {
+                s_path = argv[++i];
+            } else if (a == "--out-format" && i + 1 < argc) {
+                out_format = argv[++i];
+                if (out_format != "txt" && out_format != "bin")
+                    throw std::runtime_error("--out-format debe ser txt o bin.");
+            } else if (a == "--rank" && i + 1 < argc) {
+                rank_prm.rank = std::atoi(argv[++i]);
+                if (rank_prm.rank < 1) throw std::runtime_error("--rank debe ser un entero positivo.");
+            } else if (a == "--oversample" && i + 1 < argc) {
+                rank_prm.oversample = std::atoi(argv[++i]);
+                if (rank_prm.oversample < 0) throw std::runtime_error("--oversample debe ser un entero >= 0.");
+            } else if (a == "--power" && i + 1 < argc) {
+                rank_prm.power = std::atoi(argv[++i]);
+                if (rank_prm.power < 0) throw std::runtime_error("--power debe ser un entero >= 0.");
+            } else if (a == "--seed" && i + 1 < argc) {
+                rank_prm.seed = std::strtoull(argv[++i], nullptr, 10);
+            } else if (a == "--update" && i + 1 < argc) {
+                update_path = argv[++i];
+            } else if (a == "--cache" && i + 1 < argc) {
+                cache_dir = argv[++i];
+            } else if (a == "--serve" && i + 1 < argc) {
+                serve_addr = argv[++i];
+            } else if (a == "--check") {
+                check = true;
+            } else if (a == "--stats") {
+                stats_on = true;
+            } else if (runtime_option(argc, argv, i) || serve_option(argc, argv, i)) {
+            } else if (in_path.empty() && a.rfind("--", 0) != 0) {
+                in_path = a;
+            } else {
+                std::cerr << "Uso: " << argv[0] << " [<A.txt|A.bin>] [--driver gesdd|gesvd] [--full] [--check] [--cache <dir>]\n"
+                          << "         [--rank k [--oversample p] [--power q] [--seed s]]\n"
+                          << "       " << argv[0] << " --update <C> --s <S> --vt <VT> [--u <U>] [--stats]\n"
+                          << "         [--u <U>] [--vt <VT>] [--s <S>] [--out-format txt|bin] [--stats]\n"
+                          << "       " << argv[0] << " [--driver gesdd|gesvd] --serve unix:RUTA|tcp:HOST:PUERTO [--max-payload MiB]\n"
+                          << "  (todos los modos) " << kRuntimeUsage << "\n";
+                return 1;
+            }
+        }
+        apply_runtime();
+        if (!serve_addr.empty()) {
+            if (!in_path.empty() || !update_path.empty() || rank_prm.rank > 0 || full || check || !cache_dir.empty() ||
+                !u_path.empty() || !vt_path.empty() || !s_path.empty())
+                throw std::runtime_error("--serve solo admite --driver y las opciones de ejecución.");
+            run_server(serve_addr, driver);
+            return 0;
+        }
+        if (serve_config().max_payload_set) throw std::runtime_error("--max-payload requiere --serve.");
+        if (!update_path.empty()) {
+            if (!in_path.empty() || rank_prm.rank > 0 || full || check || !out_format.empty() || !cache_dir.empty())
+                throw std::runtime_error("--update solo admite --s, --vt, --u y --stats.");
+            if (s_path.empty() || vt_path.empty()) throw std::runtime_error("--update requiere --s y --vt.");
+            Stats stats(stats_on);
+            stats.set("tool", "\"svd_update\"");
+            runtime_stats(stats);
+            run_update(update_path, u_path, vt_path, s_path, stats);
+            stats.print_json(std::cerr);
+            return 0;
+        }
+        const bool randomized = rank_prm.rank > 0;
+        if (randomized && in_path.empty()) throw std::runtime_error("--rank requiere un archivo de entrada.");
+        if (randomized && full) throw std::runtime_error("--full no se puede combinar con --rank.");
+        if (check && in_path.empty()) throw std::runtime_error("--check requiere un archivo de entrada.");
+        if (!cache_dir.empty() && (in_path.empty() || randomized))
+            throw std::runtime_error("--cache requiere un archivo de entrada y no se combina con --rank.");
+        Stats stats(stats_on);
+        stats.set("tool", "\"svd\"");
+        runtime_stats(stats);
+
+        // -----------------------------
+        // 1) Matriz A
+        // -----------------------------
+        Input in;
+        Stopwatch sw_read;
+        if (in_path.empty()) {
+            // Matriz de la tarea, en row-major: fila por fila
+            // A = [[1, -0.8],
+            //      [0,  1.0]]
+            in.m = in.n = 2;
+            in.a.resize(4);
+            const double A0[4] = {
+                1.0, -0.8,
+                0.0,  1.0
+            };
+            std::copy(A0, A0 + 4, in.a.data());
+            in.data = in.a.data();
+            full = true;
+        } else {
+            load_matrix(in_path, in, randomized);
+        }
+        stats.add("read", sw_read.seconds(), static_cast<double>(in.bytes()));
+
+        if (in_path.empty()) driver = Driver::gesvd;
+        const int m = in.m, n = in.n;
+        if (randomized && rank_prm.rank > std::min(m, n))
+            throw std::runtime_error("--rank debe ser a lo sumo min(filas, columnas) = " +
+                                     std::to_string(std::min(m, n)) + ".");
+        const int k = randomized ? rank_prm.rank : std::min(m, n);
+        const bool small = !randomized && m <= kPrintMax && n <= kPrintMax;
+        const bool vectors = randomized || small || check || !u_path.empty() || !vt_path.empty();
+        const char job = !vectors ? 'N' : (full ? 'A' : 'S');
+        const int u_cols = full ? m : k, vt_rows = full ? n : k;
+
+        // Copia de A para comparar con la reconstrucción (solo matrices chicas)
+        std::vector<double> A_orig;
+        if (small) A_orig.assign(in.data, in.data + static_cast<size_t>(m) * n);
+
+        const bool bin_out = out_format.empty() ? in.binary : (out_format == "bin");
+        FactorOut U, VT, S;
+        if (vectors) {
+            U.open(u_path, m, u_cols, in.layout, bin_out);
+            VT.open(vt_path, vt_rows, n, in.layout, bin_out);
+        }
+        S.open(s_path, k, 1, in.layout, bin_out);
+
+        // -----------------------------
+        // 2) SVD con LAPACKE
+        // -----------------------------
+        if (randomized) {
+            std::cout << "A: " << m << "x" << n << (in.binary ? " (binario)" : " (texto)")
+                      << ", SVD aleatorizada: rango k = " << k << ", sobremuestreo p = "
+                      << sketch_cols(rank_prm, m, n) - k << ", " << rank_prm.power << " iteraciones de potencia\n";
+        } else if (!in_path.empty()) {
+            std::cout << "A: " << m << "x" << n << (in.binary ? " (binario)" : " (texto)") << ", "
+                      << (driver == Driver::gesdd ? "LAPACKE_dgesdd" : "LAPACKE_dgesvd") << ", "
+                      << (job == 'A' ? "U y V^T completas" : job == 'S' ? "modo economico" : "solo valores singulares")
+                      << "\n";
+        }
+        // -----------------------------
+        // Caché de la SVD completa
+        //
+        // La clave es el hash de A antes de que LAPACK la sobrescriba; el tag
+        // distingue job y driver (el layout ya entra en el hash). La entrada
+        // guarda S, U y V^T tal como salen (U y V^T vacías con job 'N').
+        // -----------------------------
+        const FactorCache cache(cache_dir);
+        const uint64_t cache_tag = static_cast<uint64_t>(job) | (driver == Driver::gesdd ? 1ull : 2ull) << 8;
+        const size_t u_count = vectors ? static_cast<size_t>(m) * u_cols : 0;
+        const size_t vt_count = vectors ? static_cast<size_t>(vt_rows) * n : 0;
+        uint64_t cache_key = 0;
+        bool cache_hit = false;
+        std::string cache_path;
+        if (cache.enabled()) {
+            Stopwatch sw_cache;
+            with_layout(in.layout, [&](auto lt) {
+                cache_key = hash_matrix(Matrix<const double, decltype(lt)::value>(in.a.data(), m, n));
+            });
+            CacheEntry entry;
+            cache_hit = cache.load(FactorKind::svd, cache_key, m, n, cache_tag, entry);
+            if (cache_hit) {
+                std::copy_n(entry.array<double>(0, static_cast<size_t>(k)), k, S.data());
+                std::copy_n(entry.array<double>(1, u_count), u_count, U.data());
+                std::copy_n(entry.array<double>(2, vt_count), vt_count, VT.data());
+                cache_path = entry.path();
+            }
+            stats.add("cache", sw_cache.seconds(),
+                      static_cast<double>(in.bytes() + (cache_hit ? (k + u_count + vt_count) * sizeof(double) : 0)));
+        }
+
+        Stopwatch sw_svd;
+        RsvdError rank_err;
+        if (cache_hit) {
+            // Factores ya copiados de la caché
+        } else if (randomized) {
+            with_layout(in.layout, [&](auto lt) {
+                constexpr Layout L = decltype(lt)::value;
+                rank_err = rsvd(rank_prm, Matrix<const double, L>(in.data, m, n), S.data(),
+                                Matrix<double, L>(U.data(), m, k), Matrix<double, L>(VT.data(), k, n));
+            });
+        } else if (in_path.empty()) {
+            double superb[1];
+            lapack_check(gesvd('A',                                 // calcular U completa
+                               'A',                                 // calcular V^T completa
+                               Matrix<double, Layout::row>(in.a.data(), m, n),
+                               S.data(),
+                               Matrix<double, Layout::row>(U.data(), m, m),
+                               Matrix<double, Layout::row>(VT.data(), n, n),
+                               superb),
+                         "LAPACKE_dgesvd");
+        } else {
+            with_layout(in.layout, [&](auto lt) {
+                constexpr Layout L = decltype(lt)::value;
+                svd(driver, job, Matrix<double, L>(in.a.data(), m, n), S.data(),
+                    Matrix<double, L>(U.data(), m, vectors ? u_cols : 0),
+                    Matrix<double, L>(VT.data(), vectors ? vt_rows : 0, n));
+            });
+        }
+        // Flops aproximados: 4 m n k (valores) o ~ 14 m n k con vectores; la
+        // aleatorizada, 2 m n l por cada producto con A (2q + 2, más el de B)
+        if (randomized) {
+            const double l = sketch_cols(rank_prm, m, n);
+            stats.add("rsvd", sw_svd.seconds(),
+                      static_cast<double>(in.bytes()) * (2 * rank_prm.power + 4 + 2 * kErrorPowerIters),
+                      2.0 * m * n * (l * (2 * rank_prm.power + 2) + kErrorProbes * (2 * kErrorPowerIters + 1)));
+        } else if (!cache_hit) {
+            stats.add(driver == Driver::gesdd ? "dgesdd" : "dgesvd", sw_svd.seconds(),
+                      static_cast<double>(sizeof(double)) * m * n, (vectors ? 14.0 : 4.0) * m * n * k);
+            if (cache.enabled())
+                cache_path = cache.store(FactorKind::svd, cache_key, m, n, cache_tag,
+                                         {CacheArray(S.data(), static_cast<size_t>(k)), CacheArray(U.data(), u_count),
+                                          CacheArray(VT.data(), vt_count)});
+        }
+
+        // -----------------------------
+        // 3) Reporte
+        // -----------------------------
+        std::cout << std::fixed << std::setprecision(8);
+
+        std::cout << "Valores singulares S:\n";
+        for (int i = 0; i < k; ++i)
+            std::cout << "  S[" << i << "] = " << S.data()[i] << '\n';
+
+        if (randomized) {
+            std::cout << std::scientific << std::setprecision(3)
+                      << "Error de la aproximacion de rango " << k << ":\n"
+                      << "  ||A - A_k||_F = " << rank_err.frob << " (relativo " << rank_err.frob_rel << ")\n"
+                      << "  ||A - A_k||_2 ~ " << rank_err.spec_est << " (potencia en bloque, " << kErrorProbes
+                      << " vectores, " << kErrorPowerIters << " iteraciones; por debajo)\n"
+                      << "  ||A - A_k||_2 <= " << rank_err.spec_bound << " (cota con " << kErrorProbes
+                      << " vectores aleatorios, prob. 1 - 1e-" << kErrorProbes << ")\n";
+            if (std::isnan(rank_err.sigma_next))
+                std::cout << "  sigma_{k+1}: sin estimar (p = 0)\n";
+            else
+                std::cout << "  sigma_{k+1} >= " << rank_err.sigma_next << " (del boceto: el error optimo;"
+                          << " si ||A - A_k||_2 queda muy lejos, subir p o q)\n";
+        }
+
+        if (small) {
+            with_layout(in.layout, [&](auto lt) {
+                constexpr Layout L = decltype(lt)::value;
+                print_small(Matrix<const double, L>(A_orig.data(), m, n), S.data(),
+                            Matrix<const double, L>(U.data(), m, u_cols),
+                            Matrix<const double, L>(VT.data(), vt_rows, n));
+            });
+        }
+
+        if (check) {
+            // A original: la aleatorizada no la modifica; si no, se vuelve a
+            // leer del archivo (un binario f64 queda mapeado, sin copia)
+            Input ref;
+            const double* a_ref = in.data;
+            if (!randomized) {
+                load_matrix(in_path, ref, true);
+                a_ref = ref.data;
+            }
+            Stopwatch sw_check;
+            RecError e;
+            with_layout(in.layout, [&](auto lt) {
+                constexpr Layout L = decltype(lt)::value;
+                e = reconstruction_error(Matrix<const double, L>(a_ref, m, n), S.data(), k,
+                                         Matrix<const double, L>(U.data(), m, u_cols),
+                                         Matrix<const double, L>(VT.data(), vt_rows, n));
+            });
+            stats.add("check", sw_check.seconds(), static_cast<double>(in.bytes()), 2.0 * m * n * k);
+            std::cout << std::scientific << std::setprecision(3)
+                      << "Reconstruccion U * Sigma * V^T (rango " << k << "):\n"
+                      << "  error maximo = " << e.max_abs << "\n"
+                      << "  ||A - U Sigma V^T||_F = " << e.frob << " (relativo " << e.frob_rel << ")\n";
+        }
+
+        if (cache.enabled())
+            std::cout << "Cache SVD: " << (cache_hit ? "reutilizada de " : "guardada en ") << cache_path << "\n";
+
+        Stopwatch sw_write;
+        const size_t bytes = U.finish() + VT.finish() + S.finish();
+        if (bytes > 0) stats.add("write", sw_write.seconds(), static_cast<double>(bytes));
+
+        stats.set("m", std::to_string(m));
+        stats.set("n", std::to_string(n));
+        if (randomized) {
+            stats.set("rank", std::to_string(k));
+            stats.set("oversample", std::to_string(rank_prm.oversample));
+            stats.set("power", std::to_string(rank_prm.power));
+        } else {
+            stats.set("job", std::string("\"") + job + "\"");
+            if (cache.enabled()) stats.set("cache", cache_hit ? "\"hit\"" : "\"miss\"");
+        }
+        stats.print_json(std::cerr);
+        return 0;
+
+    } catch (const std::exception& ex) {
+        std::cerr << "Error: " << ex.what() << "\n";
+        return 1;
+    }
 }
@@ -0,0 +1,214 @@
+// include/mcs/arena.hpp
+// Arena de memoria para matrices y workspaces:
+// - alloc<T>(n) / matrix<T, L>(r, c): memoria alineada a 64 bytes, sin
+//   inicializar, tomada de bloques grandes pedidos al sistema (mmap /
+//   VirtualAlloc), con páginas grandes cuando se puede
+// - mark / rewind: descarta lo reservado desde una marca
+// - reset: libera todo de una vez entre problemas o tandas
+//
+// reset no devuelve la memoria al sistema: la tanda siguiente reutiliza las
+// mismas páginas, que ya tienen su fallo de página pagado. Si la tanda
+// anterior necesitó varios bloques, reset los junta en uno del tamaño total,
+// así que después de la primera tanda no se vuelve a pedir memoria.
+//
+// Páginas grandes: en Linux se intenta MAP_HUGETLB (páginas de 2 MiB
+// reservadas por el administrador); si no hay, el bloque se alinea a 2 MiB y
+// se marca con MADV_HUGEPAGE (transparent huge pages). En Windows, MEM_LARGE_PAGES
+// requiere el privilegio SeLockMemoryPrivilege; sin él se usan páginas normales.
+//
+// Las vistas y punteros que entrega una arena valen hasta el rewind o reset
+// que los descarte. Una arena no se comparte entre hilos.
+#pragma once
+
+#include "matrix.hpp"
+#include "matrix_io.hpp" // align_up
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX // evita las macros min/max de windows.h
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+inline constexpr size_t kArenaMinBlock = size_t{4} << 20;  // 4 MiB
+inline constexpr size_t kHugePageBytes = size_t{2} << 20;  // páginas grandes de x86-64
+
+// -----------------------------
+// Bloques del sistema
+// -----------------------------
+struct ArenaBlock {
+    char* data = nullptr;
+    size_t size = 0;
+    size_t mapped = 0; // lo que hay que liberar (puede empezar antes de data)
+    char* base = nullptr;
+    bool huge = false; // páginas grandes garantizadas (MAP_HUGETLB / MEM_LARGE_PAGES)
+};
+
+inline ArenaBlock arena_map_block(size_t bytes) {
+    ArenaBlock b;
+    bytes = align_up(bytes, kHugePageBytes);
+#ifdef _WIN32
+    const SIZE_T large = GetLargePageMinimum();
+    if (large > 0) {
+        const size_t sz = align_up(bytes, large);
+        b.base = static_cast<char*>(VirtualAlloc(nullptr, sz, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE));
+        if (b.base) {
+            b.data = b.base;
+            b.size = b.mapped = sz;
+            b.huge = true;
+            return b;
+        }
+    }
+    b.base = static_cast<char*>(VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+    if (!b.base) throw std::bad_alloc();
+    b.data = b.base;
+    b.size = b.mapped = bytes;
+#else
+    void* p = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (p != MAP_FAILED) {
+        b.base = b.data = static_cast<char*>(p);
+        b.size = b.mapped = bytes;
+        b.huge = true;
+        return b;
+    }
+#endif
+    // Sobran 2 MiB para poder alinear el bloque a una página grande
+    const size_t mapped = bytes + kHugePageBytes;
+    p = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) throw std::bad_alloc();
+    b.base = static_cast<char*>(p);
+    b.mapped = mapped;
+    b.data = b.base + (align_up(reinterpret_cast<uintptr_t>(b.base), kHugePageBytes) - reinterpret_cast<uintptr_t>(b.base));
+    b.size = bytes;
+#ifdef MADV_HUGEPAGE
+    madvise(b.data, b.size, MADV_HUGEPAGE);
+#endif
+#endif
+    return b;
+}
+
+inline void arena_unmap_block(ArenaBlock& b) {
+    if (!b.base) return;
+#ifdef _WIN32
+    VirtualFree(b.base, 0, MEM_RELEASE);
+#else
+    munmap(b.base, b.mapped);
+#endif
+    b = ArenaBlock{};
+}
+
+// -----------------------------
+// Arena
+// -----------------------------
+class Arena {
+public:
+    struct Mark {
+        size_t block = 0, offset = 0;
+    };
+
+    Arena() = default;
+    explicit Arena(size_t bytes) { reserve(bytes); }
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+    Arena(Arena&& o) noexcept
+        : blocks_(std::move(o.blocks_)), cur_(std::exchange(o.cur_, 0)), off_(std::exchange(o.off_, 0)),
+          peak_(std::exchange(o.peak_, 0)) {}
+    Arena& operator=(Arena&& o) noexcept {
+        std::swap(blocks_, o.blocks_);
+        std::swap(cur_, o.cur_);
+        std::swap(off_, o.off_);
+        std::swap(peak_, o.peak_);
+        return *this;
+    }
+    ~Arena() {
+        for (ArenaBlock& b : blocks_) arena_unmap_block(b);
+    }
+
+    // Garantiza un bloque de al menos bytes (solo con la arena vacía)
+    void reserve(size_t bytes) {
+        if (used() == 0 && capacity() < bytes) {
+            for (ArenaBlock& b : blocks_) arena_unmap_block(b);
+            blocks_.assign(1, arena_map_block(bytes));
+        }
+    }
+
+    // n elementos de T sin inicializar, alineados a 64 bytes
+    template <class T>
+    T* alloc(size_t n) {
+        static_assert(std::is_trivially_copyable_v<T>, "Arena solo admite tipos triviales");
+        return static_cast<T*>(alloc_bytes(std::max<size_t>(1, n) * sizeof(T)));
+    }
+
+    template <class T, Layout L = Layout::col>
+    Matrix<T, L> matrix(int rows, int cols) {
+        return Matrix<T, L>(alloc<T>(static_cast<size_t>(rows) * static_cast<size_t>(cols)), rows, cols);
+    }
+
+    Mark mark() const { return {cur_, off_}; }
+    void rewind(Mark m) {
+        cur_ = m.block;
+        off_ = m.offset;
+    }
+
+    void reset() {
+        if (blocks_.size() > 1) {
+            size_t total = 0;
+            for (ArenaBlock& b : blocks_) {
+                total += b.size;
+                arena_unmap_block(b);
+            }
+            blocks_.assign(1, arena_map_block(total));
+        }
+        cur_ = off_ = 0;
+    }
+
+    size_t used() const {
+        size_t u = off_;
+        for (size_t i = 0; i < cur_ && i < blocks_.size(); ++i) u += blocks_[i].size;
+        return u;
+    }
+    size_t capacity() const {
+        size_t c = 0;
+        for (const ArenaBlock& b : blocks_) c += b.size;
+        return c;
+    }
+    size_t peak() const { return peak_; }
+    bool huge_pages() const {
+        return !blocks_.empty() && std::all_of(blocks_.begin(), blocks_.end(), [](const ArenaBlock& b) { return b.huge; });
+    }
+
+private:
+    void* alloc_bytes(size_t bytes) {
+        bytes = align_up(bytes, kMatrixAlign);
+        while (cur_ < blocks_.size() && off_ + bytes > blocks_[cur_].size) {
+            // El bloque actual no alcanza: pasar al siguiente (off_ = 0)
+            ++cur_;
+            off_ = 0;
+        }
+        if (cur_ == blocks_.size()) {
+            const size_t last = blocks_.empty() ? 0 : blocks_.back().size;
+            blocks_.push_back(arena_map_block(std::max({bytes, kArenaMinBlock, 2 * last})));
+            off_ = 0;
+        }
+        char* p = blocks_[cur_].data + off_;
+        off_ += bytes;
+        peak_ = std::max(peak_, used());
+        return p;
+    }
+
+    std::vector<ArenaBlock> blocks_;
+    size_t cur_ = 0, off_ = 0;
+    size_t peak_ = 0;
+};
@@ -0,0 +1,90 @@
+// include/mcs/blas.hpp
+// BLAS para las vistas Matrix<T, L>:
+// - declaraciones de dgemm_/sgemm_ (Fortran) y del control de hilos del
+//   backend: OpenBLAS por defecto, MKL con -DMCS_BLAS_MKL, BLIS con
+//   -DMCS_BLAS_BLIS (blas_set_num_threads / blas_get_num_threads)
+// - xgemm: dgemm_ o sgemm_ según T
+// - gemm: C = alpha*A*B + beta*C para cualquier combinación de layouts, sin copias
+#pragma once
+
+#include "matrix.hpp"
+
+#include <stdexcept>
+#include <type_traits>
+
+extern "C" {
+// DGEMM: C = alpha*op(A)*op(B) + beta*C
+void dgemm_(const char* TRANSA, const char* TRANSB,
+            const int* M, const int* N, const int* K,
+            const double* ALPHA,
+            const double* A, const int* LDA,
+            const double* B, const int* LDB,
+            const double* BETA,
+            double* C, const int* LDC);
+
+// SGEMM: igual que DGEMM en precisión simple
+void sgemm_(const char* TRANSA, const char* TRANSB,
+            const int* M, const int* N, const int* K,
+            const float* ALPHA,
+            const float* A, const int* LDA,
+            const float* B, const int* LDB,
+            const float* BETA,
+            float* C, const int* LDC);
+
+#if defined(MCS_BLAS_MKL)
+void MKL_Set_Num_Threads(int nth);
+int MKL_Get_Max_Threads(void);
+#elif defined(MCS_BLAS_BLIS)
+void bli_thread_set_num_threads(long long n_threads); // dim_t
+long long bli_thread_get_num_threads(void);
+#else
+// OpenBLAS: control del número de hilos
+void openblas_set_num_threads(int num_threads);
+int openblas_get_num_threads(void);
+#endif
+}
+
+#if defined(MCS_BLAS_MKL)
+inline constexpr const char* kBlasBackend = "mkl";
+inline void blas_set_num_threads(int n) { MKL_Set_Num_Threads(n); }
+inline int blas_get_num_threads() { return MKL_Get_Max_Threads(); }
+#elif defined(MCS_BLAS_BLIS)
+inline constexpr const char* kBlasBackend = "blis";
+inline void blas_set_num_threads(int n) { bli_thread_set_num_threads(n); }
+inline int blas_get_num_threads() { return static_cast<int>(bli_thread_get_num_threads()); }
+#else
+inline constexpr const char* kBlasBackend = "openblas";
+inline void blas_set_num_threads(int n) { openblas_set_num_threads(n); }
+inline int blas_get_num_threads() { return openblas_get_num_threads(); }
+#endif
+
+// xGEMM según el tipo: dgemm_ para double, sgemm_ para float
+template <class T>
+inline void xgemm(char ta, char tb, int M, int N, int K, T alpha, const T* A, int lda,
+                  const T* B, int ldb, T beta, T* C, int ldc) {
+    if constexpr (std::is_same_v<T, float>)
+        sgemm_(&ta, &tb, &M, &N, &K, &alpha, A, &lda, B, &ldb, &beta, C, &ldc);
+    else
+        dgemm_(&ta, &tb, &M, &N, &K, &alpha, A, &lda, B, &ldb, &beta, C, &ldc);
+}
+// C = alpha*A*B + beta*C (beta = 0 => C no necesita inicializarse).
+//
+// En la vista column-major que usa xGEMM, una matriz row-major X (r×c) es X^T
+// con la misma ld. Elegimos trans según eso:
+// - C col-major: se calcula C   = A   * B
+// - C row-major: se calcula C^T = B^T * A^T
+template <class TA, class TB, class T, Layout LA, Layout LB, Layout LC>
+inline void gemm(T alpha, Matrix<TA, LA> A, Matrix<TB, LB> B, T beta, Matrix<T, LC> C) {
+    static_assert(std::is_same_v<std::remove_const_t<TA>, T> && std::is_same_v<std::remove_const_t<TB>, T>,
+                  "gemm: A, B y C deben tener el mismo tipo");
+    if (A.rows() != C.rows() || A.cols() != B.rows() || B.cols() != C.cols())
+        throw std::runtime_error("gemm: dimensiones incompatibles.");
+    const int m = C.rows(), l = C.cols(), k = A.cols();
+    if (LC == Layout::col) {
+        xgemm(LA == Layout::row ? 'T' : 'N', LB == Layout::row ? 'T' : 'N', m, l, k, alpha,
+              A.data(), A.ld(), B.data(), B.ld(), beta, C.data(), C.ld());
+    } else {
+        xgemm(LB == Layout::row ? 'N' : 'T', LA == Layout::row ? 'N' : 'T', l, m, k, alpha,
+              B.data(), B.ld(), A.data(), A.ld(), beta, C.data(), C.ld());
+    }
+}
@@ -0,0 +1,247 @@
+// include/mcs/factor_cache.hpp
+// Caché persistente de factorizaciones:
+// - hash_matrix: hash de 64 bits del contenido de una matriz (esquema de
+//   XXH64: cuatro acumuladores de 8 bytes, varios GB/s)
+// - FactorCache: un archivo por factorización (QR + tau, LU + pivotes,
+//   Cholesky o SVD) en un directorio, con nombre "<hash>-<tipo>-<tag>.mcsf"
+// - CacheEntry: la entrada mapeada en memoria; los arreglos se usan en sitio
+//   (dormqr, dtrtrs, dgetrs y dpotrs leen el factor directamente del mapeo,
+//   sin copiarlo)
+//
+// Así un programa que vuelve a ver la misma matriz (la misma matriz de
+// diseño con otro y, el mismo operador en la SVD) se salta la factorización
+// y hace solo las sustituciones.
+#pragma once
+
+#include "matrix.hpp"
+#include "matrix_io.hpp" // MappedFile, align_up
+
+#include <bit>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <initializer_list>
+#include <stdexcept>
+#include <string>
+
+// -----------------------------
+// Hash de contenido
+// -----------------------------
+inline constexpr uint64_t kHashP1 = 0x9E3779B185EBCA87ull;
+inline constexpr uint64_t kHashP2 = 0xC2B2AE3D27D4EB4Full;
+inline constexpr uint64_t kHashP3 = 0x165667B19E3779F9ull;
+inline constexpr uint64_t kHashP4 = 0x85EBCA77C2B2AE63ull;
+inline constexpr uint64_t kHashP5 = 0x27D4EB2F165667C5ull;
+
+inline uint64_t hash_read64(const unsigned char* p) {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+inline uint64_t hash_round(uint64_t acc, uint64_t in) { return std::rotl(acc + in * kHashP2, 31) * kHashP1; }
+inline uint64_t hash_merge(uint64_t h, uint64_t v) { return (h ^ hash_round(0, v)) * kHashP1 + kHashP4; }
+
+inline uint64_t hash_bytes(const void* data, size_t len, uint64_t seed) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    const unsigned char* end = p + len;
+    uint64_t h;
+    if (len >= 32) {
+        uint64_t v1 = seed + kHashP1 + kHashP2, v2 = seed + kHashP2, v3 = seed, v4 = seed - kHashP1;
+        for (; p + 32 <= end; p += 32) {
+            v1 = hash_round(v1, hash_read64(p));
+            v2 = hash_round(v2, hash_read64(p + 8));
+            v3 = hash_round(v3, hash_read64(p + 16));
+            v4 = hash_round(v4, hash_read64(p + 24));
+        }
+        h = std::rotl(v1, 1) + std::rotl(v2, 7) + std::rotl(v3, 12) + std::rotl(v4, 18);
+        h = hash_merge(hash_merge(hash_merge(hash_merge(h, v1), v2), v3), v4);
+    } else {
+        h = seed + kHashP5;
+    }
+    h += len;
+    for (; p + 8 <= end; p += 8) h = std::rotl(h ^ hash_round(0, hash_read64(p)), 27) * kHashP1 + kHashP4;
+    for (; p < end; ++p) h = std::rotl(h ^ (*p * kHashP5), 11) * kHashP1;
+    h ^= h >> 33;
+    h *= kHashP2;
+    h ^= h >> 29;
+    h *= kHashP3;
+    h ^= h >> 32;
+    return h;
+}
+
+// Hash de las dimensiones, el layout y los elementos (bit a bit). Una vista
+// no contigua se recorre columna a columna (o fila a fila), encadenando.
+template <class T, Layout L>
+inline uint64_t hash_matrix(Matrix<const T, L> M) {
+    const uint64_t shape[4] = {static_cast<uint64_t>(M.rows()), static_cast<uint64_t>(M.cols()),
+                               static_cast<uint64_t>(L), sizeof(T)};
+    uint64_t h = hash_bytes(shape, sizeof(shape), 0);
+    if (M.contiguous()) return hash_bytes(M.data(), M.size() * sizeof(T), h);
+    const int lines = L == Layout::col ? M.cols() : M.rows();
+    const size_t len = static_cast<size_t>(L == Layout::col ? M.rows() : M.cols()) * sizeof(T);
+    for (int k = 0; k < lines; ++k) h = hash_bytes(M.data() + static_cast<size_t>(k) * M.ld(), len, h);
+    return h;
+}
+
+// -----------------------------
+// Archivo de caché (little-endian, como MCSM)
+//
+// Cabecera fija de 128 bytes y hasta kCacheMaxArrays arreglos, cada uno en
+// un offset alineado a 64 bytes. rows, cols y tag completan la clave: el
+// tag distingue variantes de la misma factorización (p. ej. el job de la
+// SVD); el significado de cada arreglo depende del tipo.
+// -----------------------------
+enum class FactorKind : uint32_t { qr = 1, lu = 2, chol = 3, svd = 4 };
+
+inline constexpr char     kCacheMagic[4]   = {'M', 'C', 'S', 'F'};
+inline constexpr uint32_t kCacheVersion    = 1;
+inline constexpr uint32_t kCacheMaxArrays  = 3;
+inline constexpr size_t   kCacheHeaderSize = 128;
+
+struct CacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t kind;
+    uint32_t narrays;
+    uint64_t hash;
+    uint64_t tag;
+    int64_t rows, cols;
+    struct {
+        uint64_t offset, count;
+        uint32_t elem_size, reserved;
+    } arrays[kCacheMaxArrays];
+};
+static_assert(sizeof(CacheHeader) <= kCacheHeaderSize, "la cabecera de caché debe caber en 128 bytes");
+
+inline const char* factor_kind_name(FactorKind k) {
+    switch (k) {
+    case FactorKind::qr: return "qr";
+    case FactorKind::lu: return "lu";
+    case FactorKind::chol: return "chol";
+    case FactorKind::svd: return "svd";
+    }
+    return "?";
+}
+
+// Un arreglo a guardar: count elementos de elem_size bytes
+struct CacheArray {
+    const void* data;
+    size_t count;
+    uint32_t elem_size;
+
+    template <class T>
+    CacheArray(const T* p, size_t n) : data(p), count(n), elem_size(sizeof(T)) {}
+};
+
+// Entrada encontrada: el archivo queda mapeado mientras viva la entrada.
+// El mapeo es de copia al escribir: dormqr (vía dorm2r) pone temporalmente
+// unos en la diagonal del factor aunque LAPACKE lo declare const; esas
+// páginas se copian en memoria privada y el archivo de la caché no cambia.
+class CacheEntry {
+public:
+    template <class T>
+    const T* array(uint32_t i, size_t count) const {
+        if (i >= header().narrays || header().arrays[i].elem_size != sizeof(T) || header().arrays[i].count != count)
+            throw std::runtime_error("Caché de factorizaciones: arreglo " + std::to_string(i) + " inesperado en " + path_);
+        return reinterpret_cast<const T*>(map_.data() + header().arrays[i].offset);
+    }
+    const std::string& path() const { return path_; }
+
+private:
+    friend class FactorCache;
+    const CacheHeader& header() const { return *reinterpret_cast<const CacheHeader*>(map_.data()); }
+
+    MappedFile map_;
+    std::string path_;
+};
+
+// -----------------------------
+// Directorio de caché
+//
+// Con dir vacío la caché está desactivada: load nunca encuentra nada y
+// store no escribe. Un archivo dañado o de otra versión cuenta como fallo
+// y se reemplaza en el siguiente store; store escribe "<archivo>.tmp" y lo
+// renombra, así que un lector nunca ve una entrada a medias.
+// -----------------------------
+class FactorCache {
+public:
+    FactorCache() = default;
+    explicit FactorCache(std::string dir) : dir_(std::move(dir)) {}
+
+    bool enabled() const { return !dir_.empty(); }
+
+    std::string path(FactorKind kind, uint64_t hash, uint64_t tag) const {
+        char name[64];
+        std::snprintf(name, sizeof(name), "%016llx-%s-%llx.mcsf", static_cast<unsigned long long>(hash),
+                      factor_kind_name(kind), static_cast<unsigned long long>(tag));
+        return (std::filesystem::path(dir_) / name).string();
+    }
+
+    bool load(FactorKind kind, uint64_t hash, int rows, int cols, uint64_t tag, CacheEntry& e) const {
+        if (!enabled()) return false;
+        e.path_ = path(kind, hash, tag);
+        std::error_code ec;
+        if (!std::filesystem::is_regular_file(e.path_, ec)) return false;
+        e.map_.open_read(e.path_, true); // copia al escribir: ver CacheEntry
+        if (valid(e, kind, hash, rows, cols, tag)) return true;
+        e.map_.close(); // el store siguiente la reemplaza (Windows no renombra sobre un archivo mapeado)
+        return false;
+    }
+
+    // Devuelve la ruta escrita ("" si la caché está desactivada)
+    std::string store(FactorKind kind, uint64_t hash, int rows, int cols, uint64_t tag,
+                      std::initializer_list<CacheArray> arrays) const {
+        if (!enabled()) return {};
+        if (arrays.size() > kCacheMaxArrays) throw std::runtime_error("Caché de factorizaciones: demasiados arreglos.");
+        CacheHeader h{};
+        std::memcpy(h.magic, kCacheMagic, sizeof(kCacheMagic));
+        h.version = kCacheVersion;
+        h.kind = static_cast<uint32_t>(kind);
+        h.narrays = static_cast<uint32_t>(arrays.size());
+        h.hash = hash;
+        h.tag = tag;
+        h.rows = rows;
+        h.cols = cols;
+        size_t off = kCacheHeaderSize, i = 0;
+        for (const CacheArray& a : arrays) {
+            h.arrays[i].offset = off;
+            h.arrays[i].count = a.count;
+            h.arrays[i].elem_size = a.elem_size;
+            off = align_up(off + a.count * a.elem_size, kMatrixAlign);
+            ++i;
+        }
+
+        std::filesystem::create_directories(dir_);
+        const std::string final_path = path(kind, hash, tag), tmp = final_path + ".tmp";
+        {
+            MappedFile out;
+            out.create(tmp, off);
+            std::memcpy(out.data(), &h, sizeof(h));
+            i = 0;
+            for (const CacheArray& a : arrays) {
+                if (a.count > 0) std::memcpy(out.data() + h.arrays[i].offset, a.data, a.count * a.elem_size);
+                ++i;
+            }
+        }
+        std::filesystem::rename(tmp, final_path);
+        return final_path;
+    }
+
+private:
+    static bool valid(const CacheEntry& e, FactorKind kind, uint64_t hash, int rows, int cols, uint64_t tag) {
+        if (e.map_.size() < kCacheHeaderSize) return false;
+        const CacheHeader& h = e.header();
+        if (std::memcmp(h.magic, kCacheMagic, sizeof(kCacheMagic)) != 0 || h.version != kCacheVersion ||
+            h.kind != static_cast<uint32_t>(kind) || h.hash != hash || h.tag != tag || h.rows != rows ||
+            h.cols != cols || h.narrays > kCacheMaxArrays)
+            return false;
+        for (uint32_t i = 0; i < h.narrays; ++i) {
+            const auto& a = h.arrays[i];
+            if (a.offset % kMatrixAlign != 0 || a.offset + a.count * a.elem_size > e.map_.size()) return false;
+        }
+        return true;
+    }
+
+    std::string dir_;
+};
@@ -0,0 +1,122 @@
+// include/mcs/lapack.hpp
+// Envolturas delgadas de LAPACKE para las vistas Matrix<double, L>:
+// gels y geqrf/orgqr/ormqr (QR), trtrs, gesv/getrs (LU), posv/potrs
+// (Cholesky), gesvd y gesdd (SVD). Toman filas,
+// columnas, ld y layout de la vista y devuelven el info de LAPACK tal cual;
+// lapack_check lo convierte en std::runtime_error con el mensaje de siempre.
+//
+// Las vistas pueden ser row-major o column-major (LAPACKE transpone por
+// dentro si hace falta); para los caminos rápidos conviene column-major.
+#pragma once
+
+#include <lapacke.h>
+
+#include "matrix.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+template <Layout L>
+inline constexpr int lapack_layout = L == Layout::col ? LAPACK_COL_MAJOR : LAPACK_ROW_MAJOR;
+
+// info < 0: argumento ilegal; info > 0: fallo numérico propio de cada rutina
+inline void lapack_check(lapack_int info, const char* routine, const char* failure = "fallo numérico") {
+    if (info < 0)
+        throw std::runtime_error(std::string(routine) + ": argumento ilegal en posicion " + std::to_string(-info));
+    if (info > 0)
+        throw std::runtime_error(std::string(routine) + ": " + failure + " (info=" + std::to_string(info) + ")");
+}
+
+// -----------------------------
+// Mínimos cuadrados: min ||A X - B|| con QR (DGELS)
+//
+// B tiene max(m, n) filas: entra con las m filas de B y sale con X en las
+// primeras n (y los residuos rotados en las demás). gels_lwork consulta una
+// vez el workspace para las dimensiones máximas; con él, gels no reserva.
+// -----------------------------
+inline lapack_int gels_lwork(lapack_int m, lapack_int n, lapack_int nrhs) {
+    double dummy = 0.0, wquery = 0.0;
+    const lapack_int ld = std::max<lapack_int>(1, std::max(m, n));
+    const lapack_int info = LAPACKE_dgels_work(LAPACK_COL_MAJOR, 'N', m, n, nrhs, &dummy, ld, &dummy, ld, &wquery, -1);
+    lapack_check(info, "LAPACKE_dgels_work", "fallo en la consulta de workspace");
+    return std::max<lapack_int>(1, static_cast<lapack_int>(wquery));
+}
+
+template <Layout L>
+inline lapack_int gels(Matrix<double, L> A, Matrix<double, L> B, double* work, lapack_int lwork) {
+    return LAPACKE_dgels_work(lapack_layout<L>, 'N', A.rows(), A.cols(), B.cols(), A.data(), A.ld(),
+                              B.data(), B.ld(), work, lwork);
+}
+
+// QR de Householder: geqrf deja R arriba y los reflectores abajo (con tau);
+// orgqr los convierte en las columnas de Q (m×n, ortonormales)
+template <Layout L>
+inline lapack_int geqrf(Matrix<double, L> A, double* tau) {
+    return LAPACKE_dgeqrf(lapack_layout<L>, A.rows(), A.cols(), A.data(), A.ld(), tau);
+}
+
+template <Layout L>
+inline lapack_int orgqr(Matrix<double, L> A, const double* tau) {
+    return LAPACKE_dorgqr(lapack_layout<L>, A.rows(), A.cols(), A.cols(), A.data(), A.ld(), tau);
+}
+
+// C <- Q^T C (trans = 'T') o Q C ('N') con los reflectores de geqrf (side 'L')
+template <Layout L>
+inline lapack_int ormqr(char trans, Matrix<const double, L> QR, const double* tau, Matrix<double, L> C) {
+    return LAPACKE_dormqr(lapack_layout<L>, 'L', trans, C.rows(), C.cols(), QR.cols(), QR.data(), QR.ld(), tau,
+                          C.data(), C.ld());
+}
+
+// Sustitución triangular: op(T) X = B, con T n×n (p. ej. R de geqrf)
+template <Layout L>
+inline lapack_int trtrs(char uplo, char trans, Matrix<const double, L> T, Matrix<double, L> B) {
+    return LAPACKE_dtrtrs(lapack_layout<L>, uplo, trans, 'N', T.rows(), B.cols(), T.data(), T.ld(), B.data(), B.ld());
+}
+
+// -----------------------------
+// Sistemas cuadrados: A X = B
+// -----------------------------
+// LU con pivoteo parcial (A se sobrescribe con L·U, ipiv con las permutaciones)
+template <Layout L>
+inline lapack_int gesv(Matrix<double, L> A, lapack_int* ipiv, Matrix<double, L> B) {
+    return LAPACKE_dgesv(lapack_layout<L>, A.rows(), B.cols(), A.data(), A.ld(), ipiv, B.data(), B.ld());
+}
+
+// Cholesky (A simétrica definida positiva; solo se lee el triángulo uplo)
+template <Layout L>
+inline lapack_int posv(char uplo, Matrix<double, L> A, Matrix<double, L> B) {
+    return LAPACKE_dposv(lapack_layout<L>, uplo, A.rows(), B.cols(), A.data(), A.ld(), B.data(), B.ld());
+}
+
+// Con los factores ya calculados (por gesv/getrf o posv) solo quedan las
+// sustituciones, O(n²) por columna de B
+template <Layout L>
+inline lapack_int getrs(Matrix<const double, L> LU, const lapack_int* ipiv, Matrix<double, L> B) {
+    return LAPACKE_dgetrs(lapack_layout<L>, 'N', LU.rows(), B.cols(), LU.data(), LU.ld(), ipiv, B.data(), B.ld());
+}
+
+template <Layout L>
+inline lapack_int potrs(char uplo, Matrix<const double, L> F, Matrix<double, L> B) {
+    return LAPACKE_dpotrs(lapack_layout<L>, uplo, F.rows(), B.cols(), F.data(), F.ld(), B.data(), B.ld());
+}
+
+// -----------------------------
+// SVD: A = U diag(S) V^T
+//
+// gesvd: jobu/jobvt = 'A' (completa), 'S' (económica), 'N' (no calcular).
+// gesdd: divide y vencerás, más rápido para matrices grandes; jobz igual.
+// Con 'N' la vista correspondiente puede ser vacía. superb: min(m,n)-1.
+// -----------------------------
+template <Layout L>
+inline lapack_int gesvd(char jobu, char jobvt, Matrix<double, L> A, double* S,
+                        Matrix<double, L> U, Matrix<double, L> VT, double* superb) {
+    return LAPACKE_dgesvd(lapack_layout<L>, jobu, jobvt, A.rows(), A.cols(), A.data(), A.ld(), S,
+                          U.data(), U.ld(), VT.data(), VT.ld(), superb);
+}
+
+template <Layout L>
+inline lapack_int gesdd(char jobz, Matrix<double, L> A, double* S, Matrix<double, L> U, Matrix<double, L> VT) {
+    return LAPACKE_dgesdd(lapack_layout<L>, jobz, A.rows(), A.cols(), A.data(), A.ld(), S,
+                          U.data(), U.ld(), VT.data(), VT.ld());
+}
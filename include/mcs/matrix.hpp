@@ -0,0 +1,162 @@
+// include/mcs/matrix.hpp
+// Tipos básicos de la biblioteca compartida (include/mcs):
+// - Layout: row-major o column-major (mismos valores que el formato MCSM)
+// - AlignedBuffer<T>: memoria alineada a 64 bytes, sin inicializar
+// - Matrix<T, L>: vista (puntero, filas, columnas, leading dimension) sobre
+//   memoria ajena: un mapeo, un AlignedBuffer o un std::vector
+// - MatrixBuffer<T, L>: una matriz con su propio AlignedBuffer
+//
+// Las envolturas de BLAS/LAPACK (blas.hpp, lapack.hpp) reciben Matrix, así
+// que el layout y la ld viajan con el puntero y no se repiten en cada llamada.
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+enum class Layout : uint8_t { row = 0, col = 1 }; // == kLayoutRow / kLayoutCol
+
+inline constexpr size_t kMatrixAlign = 64; // una línea de caché, y lo que pide AVX-512
+
+// -----------------------------
+// Memoria alineada sin inicializar
+//
+// A diferencia de std::vector<double>(n), resize no rellena con ceros: los
+// buffers que BLAS/LAPACK sobrescriben enteros no pagan un memset.
+// -----------------------------
+template <class T>
+class AlignedBuffer {
+    static_assert(std::is_trivially_copyable_v<T>, "AlignedBuffer solo admite tipos triviales");
+
+public:
+    AlignedBuffer() = default;
+    explicit AlignedBuffer(size_t n) { resize(n); }
+    AlignedBuffer(const AlignedBuffer& o) : AlignedBuffer(o.size_) { std::copy(o.begin(), o.end(), data_); }
+    AlignedBuffer(AlignedBuffer&& o) noexcept
+        : data_(std::exchange(o.data_, nullptr)), size_(std::exchange(o.size_, 0)), cap_(std::exchange(o.cap_, 0)) {}
+    AlignedBuffer& operator=(AlignedBuffer o) noexcept {
+        std::swap(data_, o.data_);
+        std::swap(size_, o.size_);
+        std::swap(cap_, o.cap_);
+        return *this;
+    }
+    ~AlignedBuffer() { release(); }
+
+    // n elementos sin inicializar; el contenido previo solo se conserva si
+    // cabe en la capacidad actual
+    void resize(size_t n) {
+        if (n > cap_) {
+            release();
+            data_ = static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t{kMatrixAlign}));
+            cap_ = n;
+        }
+        size_ = n;
+    }
+
+    T* data() { return data_; }
+    const T* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    T* begin() { return data_; }
+    T* end() { return data_ + size_; }
+    const T* begin() const { return data_; }
+    const T* end() const { return data_ + size_; }
+    T& operator[](size_t i) { return data_[i]; }
+    const T& operator[](size_t i) const { return data_[i]; }
+
+private:
+    void release() {
+        if (data_) ::operator delete(data_, std::align_val_t{kMatrixAlign});
+        data_ = nullptr;
+        size_ = cap_ = 0;
+    }
+
+    T* data_ = nullptr;
+    size_t size_ = 0, cap_ = 0;
+};
+
+// -----------------------------
+// Vista de matriz
+//
+// El elemento (i, j) está en data[j*ld + i] (column-major) o en
+// data[i*ld + j] (row-major). Un bloque conserva la ld del original, y la
+// misma memoria leída con el otro layout es la transpuesta.
+// -----------------------------
+inline constexpr Layout other_layout(Layout l) { return l == Layout::row ? Layout::col : Layout::row; }
+
+template <class T, Layout L = Layout::col>
+class Matrix {
+public:
+    static constexpr Layout layout = L;
+
+    Matrix() = default;
+    Matrix(T* data, int rows, int cols)
+        : Matrix(data, rows, cols, L == Layout::col ? rows : cols) {}
+    Matrix(T* data, int rows, int cols, int ld)
+        : data_(data), rows_(rows), cols_(cols), ld_(std::max(1, ld)) {}
+
+    // Matrix<double> -> Matrix<const double>
+    template <class U>
+        requires(std::is_same_v<const U, T> && !std::is_same_v<U, T>)
+    Matrix(const Matrix<U, L>& o) : Matrix(o.data(), o.rows(), o.cols(), o.ld()) {}
+
+    T* data() const { return data_; }
+    int rows() const { return rows_; }
+    int cols() const { return cols_; }
+    int ld() const { return ld_; }
+    size_t size() const { return static_cast<size_t>(rows_) * static_cast<size_t>(cols_); }
+    bool contiguous() const { return ld_ == std::max(1, L == Layout::col ? rows_ : cols_); }
+
+    T& operator()(int i, int j) const { return data_[offset(i, j)]; }
+
+    // Bloque [i0, i0 + r) × [j0, j0 + c), misma ld
+    Matrix block(int i0, int j0, int r, int c) const { return Matrix(data_ + offset(i0, j0), r, c, ld_); }
+
+    // La misma memoria con el otro layout: la transpuesta (cols × rows)
+    Matrix<T, other_layout(L)> transposed() const { return {data_, cols_, rows_, ld_}; }
+
+private:
+    size_t offset(int i, int j) const {
+        return L == Layout::col ? static_cast<size_t>(j) * ld_ + i : static_cast<size_t>(i) * ld_ + j;
+    }
+
+    T* data_ = nullptr;
+    int rows_ = 0, cols_ = 0, ld_ = 1;
+};
+
+// Matriz contigua con memoria propia (alineada, sin inicializar)
+template <class T, Layout L = Layout::col>
+class MatrixBuffer {
+public:
+    MatrixBuffer() = default;
+    MatrixBuffer(int rows, int cols) { resize(rows, cols); }
+
+    void resize(int rows, int cols) {
+        buf_.resize(static_cast<size_t>(rows) * static_cast<size_t>(cols));
+        rows_ = rows;
+        cols_ = cols;
+    }
+
+    Matrix<T, L> view() { return Matrix<T, L>(buf_.data(), rows_, cols_); }
+    Matrix<const T, L> view() const { return Matrix<const T, L>(buf_.data(), rows_, cols_); }
+    T* data() { return buf_.data(); }
+    const T* data() const { return buf_.data(); }
+    int rows() const { return rows_; }
+    int cols() const { return cols_; }
+    size_t size() const { return buf_.size(); }
+
+private:
+    AlignedBuffer<T> buf_;
+    int rows_ = 0, cols_ = 0;
+};
+
+// Llama f(std::integral_constant<Layout, ...>) según un layout leído en
+// tiempo de ejecución (p. ej. de una cabecera MCSM)
+template <class F>
+inline decltype(auto) with_layout(uint8_t layout, F&& f) {
+    if (layout == static_cast<uint8_t>(Layout::row)) return f(std::integral_constant<Layout, Layout::row>{});
+    return f(std::integral_constant<Layout, Layout::col>{});
+}
@@ -0,0 +1,566 @@
+// include/mcs/matrix_io.hpp
+// Entrada/salida de matrices compartida por los programas de las tareas:
+// - formato binario MCSM (cabecera de 64 bytes + matrices alineadas)
+// - MappedFile: archivos mapeados en memoria (mmap / MapViewOfFile)
+// - parser de texto (from_chars, por filas en paralelo): entrada del producto
+//   "m n l / A / B" o una sola matriz "filas columnas / filas"
+// - escritura de texto (to_chars, por bloques en paralelo)
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "threads.hpp" // max_threads, bind_worker
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX // evita las macros min/max de windows.h
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// -----------------------------
+// Formato binario
+//
+// Cabecera fija de 64 bytes (little-endian), seguida de `count` matrices.
+// La matriz k empieza en un offset alineado a 64 bytes y ocupa
+// rows[k]*cols[k] elementos contiguos (f64 o f32) en el layout indicado.
+//   entrada: count=2 => A (m×n), B (n×l)
+//   salida : count=1 => C (m×l)
+// -----------------------------
+inline constexpr char     kBinMagic[4]   = {'M', 'C', 'S', 'M'};
+inline constexpr uint16_t kBinVersion    = 1;
+inline constexpr uint8_t  kDtypeF64      = 1;
+inline constexpr uint8_t  kDtypeF32      = 2;
+inline constexpr uint8_t  kLayoutRow     = 0;
+inline constexpr uint8_t  kLayoutCol     = 1;
+inline constexpr size_t   kBinAlign      = 64;
+inline constexpr uint32_t kBinMaxMatrices = 3;
+
+struct BinHeader {
+    char     magic[4];
+    uint16_t version;
+    uint8_t  dtype;
+    uint8_t  layout;
+    uint32_t count;
+    uint32_t reserved;
+    uint64_t dims[kBinMaxMatrices][2]; // (rows, cols) de cada matriz
+};
+static_assert(sizeof(BinHeader) == 64, "BinHeader debe ocupar 64 bytes");
+
+inline size_t align_up(size_t x, size_t a) { return (x + a - 1) / a * a; }
+
+// dtype del formato binario para double / float
+template <class T>
+inline constexpr uint8_t dtype_of = std::is_same_v<T, float> ? kDtypeF32 : kDtypeF64;
+
+inline size_t dtype_size(uint8_t dtype) { return dtype == kDtypeF32 ? sizeof(float) : sizeof(double); }
+
+// Offset (en bytes) de la matriz k dentro del archivo
+inline size_t bin_offset(const BinHeader& h, uint32_t k) {
+    size_t off = sizeof(BinHeader);
+    for (uint32_t i = 0; i < k; ++i) {
+        off = align_up(off, kBinAlign);
+        off += static_cast<size_t>(h.dims[i][0] * h.dims[i][1]) * dtype_size(h.dtype);
+    }
+    return align_up(off, kBinAlign);
+}
+
+inline size_t bin_file_size(const BinHeader& h) {
+    const uint32_t last = h.count - 1;
+    return bin_offset(h, last) + static_cast<size_t>(h.dims[last][0] * h.dims[last][1]) * dtype_size(h.dtype);
+}
+
+inline BinHeader make_header(uint8_t layout, uint32_t count, uint8_t dtype = kDtypeF64) {
+    BinHeader h{};
+    std::memcpy(h.magic, kBinMagic, sizeof(kBinMagic));
+    h.version = kBinVersion;
+    h.dtype = dtype;
+    h.layout = layout;
+    h.count = count;
+    return h;
+}
+
+inline bool is_binary_file(const std::string& path) {
+    std::ifstream f(path, std::ios::binary);
+    char magic[4] = {};
+    return f.read(magic, sizeof(magic)) && std::memcmp(magic, kBinMagic, sizeof(kBinMagic)) == 0;
+}
+
+// -----------------------------
+// Archivo mapeado en memoria (solo lectura o lectura/escritura)
+// -----------------------------
+class MappedFile {
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() { close(); }
+
+    // Mapea un archivo existente en solo lectura. Con copy_on_write las
+    // páginas se pueden escribir, pero cada página escrita se copia en
+    // memoria privada y el archivo no cambia (LAPACK escribe temporalmente
+    // en factores que su interfaz declara const)
+    void open_read(const std::string& path, bool copy_on_write = false) {
+#ifdef _WIN32
+        file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                            OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file_ == INVALID_HANDLE_VALUE) throw std::runtime_error("No se pudo abrir el archivo de entrada: " + path);
+        LARGE_INTEGER sz;
+        if (!GetFileSizeEx(file_, &sz)) throw std::runtime_error("No se pudo obtener el tamaño de: " + path);
+        size_ = static_cast<size_t>(sz.QuadPart);
+        if (size_ == 0) return;
+        mapping_ = CreateFileMappingA(file_, nullptr, copy_on_write ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping_) throw std::runtime_error("No se pudo mapear: " + path);
+        data_ = static_cast<char*>(MapViewOfFile(mapping_, copy_on_write ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0));
+        if (!data_) throw std::runtime_error("No se pudo mapear: " + path);
+#else
+        fd_ = ::open(path.c_str(), O_RDONLY);
+        if (fd_ < 0) throw std::runtime_error("No se pudo abrir el archivo de entrada: " + path);
+        struct stat st {};
+        if (fstat(fd_, &st) != 0) throw std::runtime_error("No se pudo obtener el tamaño de: " + path);
+        size_ = static_cast<size_t>(st.st_size);
+        if (size_ == 0) return;
+        void* p = copy_on_write ? mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd_, 0)
+                                : mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd_, 0);
+        if (p == MAP_FAILED) throw std::runtime_error("No se pudo mapear: " + path);
+        data_ = static_cast<char*>(p);
+#endif
+    }
+
+    // Crea (o trunca) un archivo de `size` bytes y lo mapea en lectura/escritura
+    void create(const std::string& path, size_t size) {
+        size_ = size;
+#ifdef _WIN32
+        file_ = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr,
+                            CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file_ == INVALID_HANDLE_VALUE) throw std::runtime_error("No se pudo abrir el archivo de salida: " + path);
+        LARGE_INTEGER sz;
+        sz.QuadPart = static_cast<LONGLONG>(size);
+        mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READWRITE, sz.HighPart, sz.LowPart, nullptr);
+        if (!mapping_) throw std::runtime_error("No se pudo mapear: " + path);
+        data_ = static_cast<char*>(MapViewOfFile(mapping_, FILE_MAP_WRITE, 0, 0, 0));
+        if (!data_) throw std::runtime_error("No se pudo mapear: " + path);
+#else
+        fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd_ < 0) throw std::runtime_error("No se pudo abrir el archivo de salida: " + path);
+        if (ftruncate(fd_, static_cast<off_t>(size)) != 0) throw std::runtime_error("No se pudo reservar espacio en: " + path);
+        void* p = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (p == MAP_FAILED) throw std::runtime_error("No se pudo mapear: " + path);
+        data_ = static_cast<char*>(p);
+#endif
+    }
+
+    void close() {
+#ifdef _WIN32
+        if (data_) UnmapViewOfFile(data_);
+        if (mapping_) CloseHandle(mapping_);
+        if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+        mapping_ = nullptr;
+        file_ = INVALID_HANDLE_VALUE;
+#else
+        if (data_) munmap(data_, size_);
+        if (fd_ >= 0) ::close(fd_);
+        fd_ = -1;
+#endif
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+    char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    char* data_ = nullptr;
+    size_t size_ = 0;
+#ifdef _WIN32
+    HANDLE file_ = INVALID_HANDLE_VALUE;
+    HANDLE mapping_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+};
+
+// Campos fijos de la cabecera: magic, versión, dtype y layout
+inline void validate_bin_header(const BinHeader& h) {
+    if (std::memcmp(h.magic, kBinMagic, sizeof(kBinMagic)) != 0) throw std::runtime_error("El archivo no es binario MCSM.");
+    if (h.version != kBinVersion) throw std::runtime_error("Versión de formato binario no soportada: " + std::to_string(h.version));
+    if (h.dtype != kDtypeF64 && h.dtype != kDtypeF32) throw std::runtime_error("dtype no soportado (se espera f64 o f32): " + std::to_string(h.dtype));
+    if (h.layout != kLayoutRow && h.layout != kLayoutCol) throw std::runtime_error("Layout inválido: " + std::to_string(h.layout));
+}
+
+// Dimensiones de las h.count matrices y tamaño del archivo
+//
+// El tamaño se suma como en bin_offset / bin_file_size, pero comprobando el
+// desborde: dims cuyo producto da la vuelta en 64 bits (p. ej.
+// 1073807362×2147352580 en f64 da 64 bytes) no pasan con un archivo chico.
+// Después de esta validación bin_offset y bin_file_size no desbordan.
+inline void validate_bin_dims(const BinHeader& h, size_t file_size) {
+    if (h.count == 0 || h.count > kBinMaxMatrices)
+        throw std::runtime_error("Cantidad de matrices inválida en la cabecera binaria.");
+    const size_t elem = dtype_size(h.dtype);
+    size_t need = sizeof(BinHeader);
+    for (uint32_t k = 0; k < h.count; ++k) {
+        for (int d = 0; d < 2; ++d)
+            if (h.dims[k][d] == 0 || h.dims[k][d] > static_cast<uint64_t>(INT_MAX))
+                throw std::runtime_error("Dimensiones inválidas en la cabecera binaria.");
+        const size_t rows = static_cast<size_t>(h.dims[k][0]), cols = static_cast<size_t>(h.dims[k][1]);
+        if (rows > SIZE_MAX / cols / elem || need > SIZE_MAX - kBinAlign)
+            throw std::runtime_error("Dimensiones demasiado grandes en la cabecera binaria.");
+        const size_t bytes = rows * cols * elem;
+        need = align_up(need, kBinAlign);
+        if (bytes > SIZE_MAX - need) throw std::runtime_error("Dimensiones demasiado grandes en la cabecera binaria.");
+        need += bytes;
+    }
+    if (file_size < need) throw std::runtime_error("Archivo binario truncado (faltan datos).");
+}
+
+// Valida la cabecera de una entrada binaria de `file_size` bytes y devuelve m, n, l
+inline void validate_bin_input(const BinHeader& h, size_t file_size, int& m, int& n, int& l) {
+    validate_bin_header(h);
+    if (h.count != 2) throw std::runtime_error("La entrada binaria debe contener 2 matrices (A y B).");
+    if (h.dims[0][1] != h.dims[1][0]) throw std::runtime_error("Dimensiones incompatibles: cols(A) != filas(B).");
+    validate_bin_dims(h, file_size);
+    m = static_cast<int>(h.dims[0][0]);
+    n = static_cast<int>(h.dims[0][1]);
+    l = static_cast<int>(h.dims[1][1]);
+}
+
+// Valida la cabecera de un archivo de entrada mapeado y devuelve m, n, l
+inline const BinHeader& read_bin_input(const MappedFile& f, int& m, int& n, int& l) {
+    if (f.size() < sizeof(BinHeader)) throw std::runtime_error("Archivo binario truncado (cabecera incompleta).");
+    const auto& h = *reinterpret_cast<const BinHeader*>(f.data());
+    validate_bin_input(h, f.size(), m, n, l);
+    return h;
+}
+
+// Igual para un archivo con una sola matriz (como la salida C del producto);
+// los datos empiezan en bin_offset(h, 0)
+inline const BinHeader& read_bin_matrix(const MappedFile& f, int& rows, int& cols) {
+    if (f.size() < sizeof(BinHeader)) throw std::runtime_error("Archivo binario truncado (cabecera incompleta).");
+    const auto& h = *reinterpret_cast<const BinHeader*>(f.data());
+    validate_bin_header(h);
+    if (h.count != 1) throw std::runtime_error("El archivo binario debe contener una sola matriz.");
+    validate_bin_dims(h, f.size());
+    rows = static_cast<int>(h.dims[0][0]);
+    cols = static_cast<int>(h.dims[0][1]);
+    return h;
+}
+
+// -----------------------------
+// Parser de texto rápido
+//
+// El archivo completo se mapea en memoria y los números se convierten con
+// std::from_chars (sin locale ni iostream). Para archivos grandes con el
+// formato recomendado (una fila por línea) las filas se reparten entre
+// hilos. Si el archivo no sigue ese formato, o hay un error, se vuelve al
+// parseo secuencial por tokens, que reproduce los mensajes de error.
+// -----------------------------
+inline constexpr size_t kParallelParseMinBytes = size_t{4} << 20; // 4 MiB
+
+inline bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// Lee el siguiente número (double o float) de [p, end) saltando espacios; avanza p
+template <class T>
+inline bool parse_number(const char*& p, const char* end, T& v) {
+    while (p < end && is_space(*p)) ++p;
+    const char* q = p;
+    if (q < end && *q == '+') ++q; // operator>> acepta '+', from_chars no
+    const auto [ptr, ec] = std::from_chars(q, end, v);
+    if (ec != std::errc{}) return false;
+    p = ptr;
+    return true;
+}
+
+inline bool is_blank_line(const char* p, const char* e) {
+    for (; p < e; ++p)
+        if (!is_space(*p)) return false;
+    return true;
+}
+
+// Lee `count` enteros positivos; `expected` describe la línea para el error
+inline void parse_dim_list(const char*& p, const char* end, int* const* dims, int count, const char* expected) {
+    for (int k = 0; k < count; ++k) {
+        while (p < end && is_space(*p)) ++p;
+        const char* q = p;
+        if (q < end && *q == '+') ++q;
+        const auto [ptr, ec] = std::from_chars(q, end, *dims[k]);
+        if (ec != std::errc{} || *dims[k] <= 0) {
+            throw std::runtime_error(std::string("Dimensiones inválidas. Se espera: ") + expected + " (enteros positivos).");
+        }
+        p = ptr;
+    }
+}
+
+// Entrada del producto: "m n l"
+inline void parse_text_dims(const char*& p, const char* end, int& m, int& n, int& l) {
+    int* const dims[3] = {&m, &n, &l};
+    parse_dim_list(p, end, dims, 3, "m n l");
+}
+
+// Una sola matriz (como la salida del producto): "filas columnas", solas en
+// su línea (así una entrada "m n l" del producto no se lee como matriz)
+inline void parse_text_shape(const char*& p, const char* end, int& rows, int& cols) {
+    int* const dims[2] = {&rows, &cols};
+    parse_dim_list(p, end, dims, 2, "filas columnas");
+    const void* nl = std::memchr(p, '\n', static_cast<size_t>(end - p));
+    if (!is_blank_line(p, nl ? static_cast<const char*>(nl) : end))
+        throw std::runtime_error("Dimensiones inválidas. Se espera: filas columnas (solas en la primera línea).");
+}
+
+// Parseo secuencial por tokens de una matriz (rows×cols) row-major en dst
+template <class T>
+inline void parse_matrix_row_major(const char*& p, const char* end, int rows, int cols,
+                                   const std::string& name, T* dst) {
+    for (int i = 0; i < rows; ++i) {
+        for (int j = 0; j < cols; ++j) {
+            if (!parse_number(p, end, dst[static_cast<size_t>(i) * cols + j])) {
+                throw std::runtime_error("Error leyendo matriz " + name +
+                                         " en (" + std::to_string(i) + "," + std::to_string(j) + ").");
+            }
+        }
+    }
+}
+
+// Una matriz row-major del texto: rows líneas de cols valores, en dst
+template <class T>
+struct TextBlock {
+    int rows, cols;
+    T* dst;
+};
+
+// Parseo paralelo por líneas: las líneas no vacías son, en orden, las filas
+// de blocks[0], blocks[1], ... Devuelve false si el archivo no tiene
+// exactamente Σ rows líneas de datos con el número correcto de valores.
+template <class T>
+inline bool parse_rows_parallel(const char* begin, const char* end, const TextBlock<T>* blocks, size_t nblocks,
+                                unsigned nthreads) {
+    const size_t len = static_cast<size_t>(end - begin);
+    size_t total_rows = 0;
+    for (size_t b = 0; b < nblocks; ++b) total_rows += static_cast<size_t>(blocks[b].rows);
+
+    // Fronteras de los bloques, justo después de un '\n'
+    std::vector<const char*> bounds(nthreads + 1);
+    bounds[0] = begin;
+    bounds[nthreads] = end;
+    for (unsigned t = 1; t < nthreads; ++t) {
+        const char* q = begin + len / nthreads * t;
+        if (q < bounds[t - 1]) q = bounds[t - 1];
+        const void* nl = std::memchr(q, '\n', static_cast<size_t>(end - q));
+        bounds[t] = nl ? static_cast<const char*>(nl) + 1 : end;
+    }
+
+    auto for_each_line = [](const char* p, const char* e, auto&& fn) {
+        while (p < e) {
+            const void* nl = std::memchr(p, '\n', static_cast<size_t>(e - p));
+            const char* le = nl ? static_cast<const char*>(nl) : e;
+            if (!is_blank_line(p, le)) {
+                if (!fn(p, le)) return false;
+            }
+            p = le + 1;
+        }
+        return true;
+    };
+
+    auto run = [&](auto&& body) {
+        std::vector<std::thread> pool;
+        pool.reserve(nthreads);
+        for (unsigned t = 0; t < nthreads; ++t)
+            pool.emplace_back([&body, t] {
+                bind_worker(t); // con --bind, las filas quedan en el nodo del hilo (first touch)
+                body(t);
+            });
+        for (auto& th : pool) th.join();
+    };
+
+    // Fase 1: contar líneas de datos por bloque
+    std::vector<size_t> first_row(nthreads + 1, 0);
+    run([&](unsigned t) {
+        size_t count = 0;
+        for_each_line(bounds[t], bounds[t + 1], [&](const char*, const char*) { ++count; return true; });
+        first_row[t + 1] = count;
+    });
+    for (unsigned t = 0; t < nthreads; ++t) first_row[t + 1] += first_row[t];
+    if (first_row[nthreads] != total_rows) return false;
+
+    // Fase 2: cada hilo parsea sus filas
+    std::atomic<bool> ok{true};
+    run([&](unsigned t) {
+        // Bloque y fila dentro del bloque de la primera línea de este hilo
+        size_t b = 0, r = first_row[t];
+        while (b < nblocks && r >= static_cast<size_t>(blocks[b].rows)) r -= static_cast<size_t>(blocks[b++].rows);
+        const bool good = for_each_line(bounds[t], bounds[t + 1], [&](const char* p, const char* le) {
+            if (!ok.load(std::memory_order_relaxed)) return false;
+            const int cols = blocks[b].cols;
+            T* row = blocks[b].dst + r * static_cast<size_t>(cols);
+            for (int j = 0; j < cols; ++j)
+                if (!parse_number(p, le, row[j])) return false;
+            if (++r == static_cast<size_t>(blocks[b].rows)) {
+                r = 0;
+                ++b;
+            }
+            return is_blank_line(p, le);
+        });
+        if (!good) ok.store(false, std::memory_order_relaxed);
+    });
+    return ok.load();
+}
+
+// Intenta el parseo paralelo de [p, end) (justo después de la línea de
+// dimensiones); false si el archivo es chico o no tiene una fila por línea
+template <class T>
+inline bool try_parse_parallel(const char* p, const char* end, const TextBlock<T>* blocks, size_t nblocks) {
+    const unsigned hw = max_threads();
+    const size_t bytes = static_cast<size_t>(end - p);
+    if (hw <= 1 || bytes < kParallelParseMinBytes) return false;
+    // Las dimensiones deben ir solas en su línea para repartir por líneas
+    const void* nl = std::memchr(p, '\n', bytes);
+    if (!nl || !is_blank_line(p, static_cast<const char*>(nl))) return false;
+    const char* body = static_cast<const char*>(nl) + 1;
+    const unsigned nthreads = static_cast<unsigned>(
+        std::min<size_t>(hw, std::max<size_t>(1, bytes / (kParallelParseMinBytes / 4))));
+    return parse_rows_parallel(body, end, blocks, nblocks, nthreads);
+}
+
+// Parsea el texto [p, end) (ya sin la línea de dimensiones) en A (m×n) y B (n×l)
+template <class T>
+inline void parse_text_matrices(const char* p, const char* end, int m, int n, int l,
+                                T* A, T* B) {
+    const TextBlock<T> blocks[2] = {{m, n, A}, {n, l, B}};
+    if (try_parse_parallel(p, end, blocks, 2)) return;
+    parse_matrix_row_major(p, end, m, n, "A", A);
+    parse_matrix_row_major(p, end, n, l, "B", B);
+}
+
+// Parsea el texto [p, end) (ya sin "filas columnas") en una matriz row-major
+template <class T>
+inline void parse_text_matrix(const char* p, const char* end, int rows, int cols, T* dst) {
+    const TextBlock<T> block{rows, cols, dst};
+    if (try_parse_parallel(p, end, &block, 1)) return;
+    parse_matrix_row_major(p, end, rows, cols, "A", dst);
+}
+
+// Inicio de cada línea de datos de [p, end) (justo después de la línea de
+// dimensiones), para parsear el texto por tramos de filas. false si las
+// dimensiones no van solas en su línea o no hay exactamente rows líneas no
+// vacías (el llamador vuelve al parseo completo, que da el mensaje de error).
+inline bool index_text_lines(const char* p, const char* end, size_t rows, std::vector<const char*>& starts) {
+    starts.clear();
+    const void* nl = std::memchr(p, '\n', static_cast<size_t>(end - p));
+    if (!nl || !is_blank_line(p, static_cast<const char*>(nl))) return false;
+    starts.reserve(rows);
+    for (p = static_cast<const char*>(nl) + 1; p < end;) {
+        nl = std::memchr(p, '\n', static_cast<size_t>(end - p));
+        const char* le = nl ? static_cast<const char*>(nl) : end;
+        if (!is_blank_line(p, le)) {
+            if (starts.size() == rows) return false;
+            starts.push_back(p);
+        }
+        p = le + 1;
+    }
+    return starts.size() == rows;
+}
+
+// Parsea [begin, end), que tiene exactamente block.rows líneas de datos (un
+// tramo de index_text_lines), en paralelo si es grande
+template <class T>
+inline bool parse_text_rows(const char* begin, const char* end, const TextBlock<T>& block) {
+    const size_t bytes = static_cast<size_t>(end - begin);
+    const unsigned nthreads = bytes < kParallelParseMinBytes
+                                  ? 1u
+                                  : static_cast<unsigned>(std::min<size_t>(max_threads(), bytes / (kParallelParseMinBytes / 4)));
+    return parse_rows_parallel(begin, end, &block, 1, nthreads);
+}
+
+// -----------------------------
+// Escritura de texto rápida
+//
+// Cada valor se formatea con std::to_chars (el decimal más corto que
+// reproduce exactamente el double o float) en buffers grandes, uno por hilo.
+// Las filas se formatean por bloques en paralelo y los buffers se escriben
+// en orden, con pocas escrituras grandes. El formato es el mismo:
+// "m l" y luego una fila por línea, valores separados por un espacio.
+// -----------------------------
+inline constexpr size_t kWriteBlockBytes = size_t{4} << 20; // 4 MiB por bloque
+inline constexpr size_t kMaxDoubleChars  = 24;              // "-1.2345678901234567e-308"
+
+// Formatea las filas [r0, r1) en buf y devuelve el número de bytes escritos
+template <class T>
+inline size_t format_rows(char* buf, const T* rm, int r0, int r1, int cols) {
+    char* p = buf;
+    for (int i = r0; i < r1; ++i) {
+        const T* row = rm + static_cast<size_t>(i) * cols;
+        for (int j = 0; j < cols; ++j) {
+            p = std::to_chars(p, p + kMaxDoubleChars, row[j]).ptr;
+            *p++ = (j + 1 < cols) ? ' ' : '\n';
+        }
+    }
+    return static_cast<size_t>(p - buf);
+}
+
+// Solo las filas [r0, r1) de rm, sin la línea "m l" (para escribir C por
+// bloques a medida que se calcula)
+template <class T>
+inline void write_rows_row_major(std::ostream& out, const T* rm, int r0, int r1, int cols) {
+    const int rows = r1 - r0;
+    if (rows <= 0) return;
+    const size_t row_bytes = static_cast<size_t>(cols) * (kMaxDoubleChars + 1);
+    const int rows_per_block = static_cast<int>(
+        std::clamp<size_t>(kWriteBlockBytes / row_bytes, 1, static_cast<size_t>(rows)));
+    const int nblocks = (rows + rows_per_block - 1) / rows_per_block;
+    const unsigned hw = max_threads();
+    const int nthreads = static_cast<int>(std::min<unsigned>(hw, static_cast<unsigned>(nblocks)));
+
+    std::vector<std::vector<char>> bufs(static_cast<size_t>(nthreads),
+                                        std::vector<char>(row_bytes * rows_per_block));
+    std::vector<size_t> lens(static_cast<size_t>(nthreads));
+
+    // Por rondas: cada hilo formatea un bloque y luego se escriben en orden
+    for (int first = 0; first < nblocks; first += nthreads) {
+        const int count = std::min(nthreads, nblocks - first);
+        auto format_block = [&](int t) {
+            const int b0 = r0 + (first + t) * rows_per_block;
+            const int b1 = std::min(r1, b0 + rows_per_block);
+            lens[static_cast<size_t>(t)] = format_rows(bufs[static_cast<size_t>(t)].data(), rm, b0, b1, cols);
+        };
+        if (count == 1) {
+            format_block(0);
+        } else {
+            std::vector<std::thread> pool;
+            pool.reserve(static_cast<size_t>(count));
+            for (int t = 0; t < count; ++t)
+                pool.emplace_back([&format_block, t] {
+                    bind_worker(static_cast<unsigned>(t));
+                    format_block(t);
+                });
+            for (auto& th : pool) th.join();
+        }
+        for (int t = 0; t < count; ++t)
+            out.write(bufs[static_cast<size_t>(t)].data(), static_cast<std::streamsize>(lens[static_cast<size_t>(t)]));
+    }
+    if (!out) throw std::runtime_error("Error escribiendo la matriz de salida.");
+}
+
+template <class T>
+inline void write_matrix_row_major(std::ostream& out, const T* rm, int rows, int cols) {
+    out << rows << " " << cols << "\n";
+    write_rows_row_major(out, rm, 0, rows, cols);
+}
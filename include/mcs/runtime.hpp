@@ -0,0 +1,143 @@
+// include/mcs/runtime.hpp
+// Opciones de ejecución comunes a todos los programas:
+//   --threads N                  hilos de BLAS y de los pools propios
+//   --bind none|close|spread     afinidad de los hilos (ver threads.hpp)
+//   --backend openblas|mkl|blis  BLAS con el que se compiló el programa
+// El backend se elige al compilar (-DMCS_BLAS_MKL, -DMCS_BLAS_BLIS; por
+// defecto OpenBLAS) porque define qué biblioteca se enlaza; --backend
+// comprueba que coincida y lo deja explícito en el comando y en --stats.
+//
+// apply_runtime() se llama una vez, después de leer las opciones y antes
+// de reservar o tocar las matrices:
+// - fija los hilos de BLAS (blas_set_num_threads)
+// - con --bind, calcula la CPU de cada ranura, fija el hilo principal a la
+//   ranura 0 y los hilos de OpenBLAS a las ranuras 1..N-1
+//   (openblas_setaffinity; con MKL o BLIS se exportan OMP_PROC_BIND y
+//   OMP_PLACES, que su runtime de OpenMP lee al crear los hilos)
+//
+// Ubicación NUMA (first touch): Linux pone cada página en el nodo del hilo
+// que la escribe primero. Con --bind el parseo de texto escribe cada bloque
+// de filas desde el hilo de su ranura, y place_local copia una entrada
+// mapeada a memoria propia de la misma forma; así A, B y C quedan
+// repartidas entre los nodos como los hilos de DGEMM que las leen.
+#pragma once
+
+#include "blas.hpp"
+#include "stats.hpp"
+#include "threads.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if !defined(MCS_BLAS_MKL) && !defined(MCS_BLAS_BLIS) && defined(__linux__)
+extern "C" int openblas_setaffinity(int thread_idx, size_t cpusetsize, cpu_set_t* cpu_set);
+#endif
+
+// Bloque mínimo por hilo de place_local (más chico no compensa crear hilos)
+inline constexpr size_t kPlaceLocalMinBytes = size_t{8} << 20;
+inline constexpr size_t kPageBytes = 4096;
+
+// Consume argv[i] (y su valor) si es una opción de ejecución
+inline bool runtime_option(int argc, char** argv, int& i) {
+    const std::string a = argv[i];
+    ThreadConfig& cfg = thread_config();
+    if (a == "--threads" && i + 1 < argc) {
+        cfg.threads = std::atoi(argv[++i]);
+        if (cfg.threads < 1) throw std::runtime_error("--threads debe ser un entero positivo.");
+        return true;
+    }
+    if (a == "--bind" && i + 1 < argc) {
+        const std::string v = argv[++i];
+        if (v == "none") cfg.bind = Bind::none;
+        else if (v == "close") cfg.bind = Bind::close;
+        else if (v == "spread") cfg.bind = Bind::spread;
+        else throw std::runtime_error("--bind debe ser none, close o spread.");
+        return true;
+    }
+    if (a == "--backend" && i + 1 < argc) {
+        const std::string v = argv[++i];
+        if (v != "openblas" && v != "mkl" && v != "blis")
+            throw std::runtime_error("--backend debe ser openblas, mkl o blis.");
+        if (v != kBlasBackend) {
+            const std::string how = v == "mkl" ? "con -DMCS_BLAS_MKL" : v == "blis" ? "con -DMCS_BLAS_BLIS" : "sin -DMCS_BLAS_*";
+            throw std::runtime_error("Este programa se compiló con " + std::string(kBlasBackend) + "; para " + v +
+                                     " hay que recompilarlo " + how + " y enlazar esa biblioteca.");
+        }
+        return true;
+    }
+    return false;
+}
+
+inline constexpr const char* kRuntimeUsage = "[--threads N] [--bind none|close|spread] [--backend openblas|mkl|blis]";
+
+inline void apply_runtime() {
+    ThreadConfig& cfg = thread_config();
+    if (cfg.threads > 0) blas_set_num_threads(cfg.threads);
+    if (cfg.bind == Bind::none) return;
+
+    const auto nodes = numa_topology();
+    cfg.numa_nodes = static_cast<int>(nodes.size());
+    const unsigned n = cfg.threads > 0 ? static_cast<unsigned>(cfg.threads)
+                                       : static_cast<unsigned>(std::max(1, blas_get_num_threads()));
+    cfg.slots = cpu_slots(cfg.bind, std::max(n, max_threads()), nodes);
+    bind_worker(0);
+#if defined(MCS_BLAS_MKL) || defined(MCS_BLAS_BLIS)
+    // No pisa lo que el usuario ya haya exportado
+#ifdef _WIN32
+    if (!std::getenv("OMP_PROC_BIND")) _putenv_s("OMP_PROC_BIND", bind_name(cfg.bind));
+    if (!std::getenv("OMP_PLACES")) _putenv_s("OMP_PLACES", "cores");
+#else
+    setenv("OMP_PROC_BIND", bind_name(cfg.bind), 0);
+    setenv("OMP_PLACES", "cores", 0);
+#endif
+#elif defined(__linux__)
+    // El hilo 0 de OpenBLAS es el que llama (ya fijado); sus workers son 0..n-2
+    for (unsigned t = 1; t < n; ++t) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cfg.slots[t % cfg.slots.size()], &set);
+        openblas_setaffinity(static_cast<int>(t - 1), sizeof(set), &set);
+    }
+#endif
+}
+
+// dst[0..n) = src[0..n) repartido en bloques contiguos (alineados a página)
+// entre los hilos de las ranuras: con --bind cada bloque queda en el nodo
+// de su hilo. Sin --bind es una copia simple.
+template <class T>
+inline void place_local(T* dst, const T* src, size_t n) {
+    const size_t bytes = n * sizeof(T);
+    const unsigned nthreads = thread_config().bind == Bind::none
+                                  ? 1u
+                                  : static_cast<unsigned>(std::clamp<size_t>(bytes / kPlaceLocalMinBytes, 1, max_threads()));
+    if (nthreads == 1) {
+        std::copy_n(src, n, dst);
+        return;
+    }
+    // per = ceil(n / nthreads) redondeado a página; el último hilo copia hasta n
+    const size_t page = kPageBytes / sizeof(T);
+    const size_t per = ((n + nthreads - 1) / nthreads + page - 1) / page * page;
+    auto body = [&](unsigned t) {
+        bind_worker(t);
+        const size_t i0 = std::min(n, t * per);
+        const size_t i1 = t + 1 == nthreads ? n : std::min(n, i0 + per);
+        std::copy(src + i0, src + i1, dst + i0);
+    };
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < nthreads; ++t) pool.emplace_back(body, t);
+    body(0);
+    for (auto& th : pool) th.join();
+}
+
+// Campos de --stats: "threads", "bind", "backend", "numa_nodes"
+inline void runtime_stats(Stats& stats) {
+    const ThreadConfig& cfg = thread_config();
+    stats.set("backend", std::string("\"") + kBlasBackend + "\"");
+    stats.set("threads", std::to_string(blas_get_num_threads()));
+    stats.set("bind", std::string("\"") + bind_name(cfg.bind) + "\"");
+    if (cfg.bind != Bind::none) stats.set("numa_nodes", std::to_string(cfg.numa_nodes));
+}
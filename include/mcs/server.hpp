@@ -0,0 +1,443 @@
+// include/mcs/server.hpp
+// Modo servidor (--serve <dirección>): el programa queda escuchando en un
+// socket Unix o TCP y resuelve trabajos (producto, ajuste, SVD) sin volver a
+// arrancar. El proceso, OpenBLAS/LAPACKE ya enlazados, los hilos de BLAS y
+// las arenas de cada conexión quedan calientes entre trabajos.
+//
+// Direcciones: "unix:/tmp/mcs.sock" (no en Windows) o "tcp:127.0.0.1:5555".
+//
+// Protocolo (little-endian, como MCSM). Cada petición y cada respuesta es
+// una trama JobFrame de 32 bytes seguida de `size` bytes de payload:
+//   petición : op, id, param; payload = contenedor MCSM con las entradas
+//   respuesta: mismo op e id; status 0 => payload = MCSM con los resultados,
+//              status 1 => payload = mensaje de error (texto UTF-8)
+// Los trabajos de una conexión se responden en orden; el cliente puede
+// enviar varios sin esperar las respuestas (pipelining).
+//
+// Cada conexión es un pipeline de tres etapas con kServeSlots trabajos en
+// vuelo: un hilo lee y valida la trama siguiente mientras otro calcula la
+// actual y un tercero envía la anterior. Cada ranura tiene su Arena: el
+// payload se lee ahí directamente (alineado a 64 bytes, sin copias) y la
+// respuesta se arma ahí mismo, así que un trabajo no reserva memoria.
+// El cómputo de todas las conexiones se serializa con un mutex: BLAS ya usa
+// todos los hilos y el handler puede guardar workspaces entre trabajos.
+//
+// Un payload se reserva entero antes de leerlo, así que su tamaño está
+// acotado: --max-payload MiB (por defecto kServeDefaultMaxPayload). A una
+// trama más grande se le responde un error, sin reservar ni leer su payload,
+// y se cierra la conexión.
+//
+// En Windows hay que enlazar ws2_32 (-lws2_32).
+#pragma once
+
+#include "arena.hpp"
+#include "matrix_io.hpp" // BinHeader, validate_bin_header, bin_offset
+#include "threads.hpp"   // BlockingQueue
+#include "transpose.hpp" // to_col_major
+
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+// -----------------------------
+// Trama
+// -----------------------------
+inline constexpr char     kJobMagic[4] = {'M', 'C', 'S', 'J'};
+inline constexpr uint32_t kJobOk       = 0;
+inline constexpr uint32_t kJobError    = 1;
+
+// Operaciones (cada programa atiende las suyas; ping, todos)
+inline constexpr uint32_t kJobPing     = 0; // sin entradas ni resultados
+inline constexpr uint32_t kJobMultiply = 1; // app.exe  : A, B -> C
+inline constexpr uint32_t kJobFit      = 2; // app2/app3: x (m×1), Y (m×k) -> coeficientes (n×k), sse (1×k)
+inline constexpr uint32_t kJobSvd      = 3; // svd_A.exe: A (m×n) -> S (k×1), U (m×k), Vᵀ (k×n)
+
+inline constexpr size_t kServeSlots     = 4;                     // trabajos en vuelo por conexión
+inline constexpr size_t kServeDefaultMaxPayload = size_t{256} << 20; // 256 MiB por trabajo
+inline constexpr int kAcceptRetryMs = 100; // espera tras un accept fallido (p. ej. EMFILE)
+
+struct ServeConfig {
+    size_t max_payload = kServeDefaultMaxPayload;
+    bool max_payload_set = false; // --max-payload solo vale con --serve
+};
+
+inline ServeConfig& serve_config() {
+    static ServeConfig cfg;
+    return cfg;
+}
+
+// Consume argv[i] (y su valor) si es una opción del servidor
+inline bool serve_option(int argc, char** argv, int& i) {
+    const std::string a = argv[i];
+    if (a == "--max-payload" && i + 1 < argc) {
+        const long long mib = std::atoll(argv[++i]);
+        if (mib <= 0) throw std::runtime_error("--max-payload debe ser un entero positivo (MiB).");
+        serve_config().max_payload = static_cast<size_t>(mib) << 20;
+        serve_config().max_payload_set = true;
+        return true;
+    }
+    return false;
+}
+
+struct JobFrame {
+    char magic[4];
+    uint32_t op;
+    uint64_t id;     // lo elige el cliente; la respuesta lo repite
+    uint64_t size;   // bytes de payload que siguen a la trama
+    int32_t param;   // parámetro de la operación (p. ej. el grado del ajuste)
+    uint32_t status; // solo en respuestas
+};
+static_assert(sizeof(JobFrame) == 32, "JobFrame debe ocupar 32 bytes");
+
+// -----------------------------
+// Entradas y resultados de un trabajo
+// -----------------------------
+// Entradas: el contenedor MCSM de la petición (vacío para ping)
+class JobInput {
+public:
+    void assign(char* blob, size_t size) {
+        blob_ = blob;
+        size_ = size;
+        if (size == 0) return;
+        if (size < sizeof(BinHeader)) throw std::runtime_error("Payload truncado (cabecera MCSM incompleta).");
+        if (std::memcmp(blob, kBinMagic, sizeof(kBinMagic)) != 0) throw std::runtime_error("El payload no es un contenedor MCSM.");
+        const auto& h = *reinterpret_cast<const BinHeader*>(blob);
+        validate_bin_header(h);
+        if (h.count == 0 || h.count > kBinMaxMatrices) throw std::runtime_error("Cantidad de matrices inválida en el payload.");
+        validate_bin_dims(h, size);
+    }
+
+    uint32_t count() const { return size_ == 0 ? 0 : header().count; }
+    uint8_t dtype() const { return header().dtype; }
+    uint8_t layout() const { return header().layout; }
+    int rows(uint32_t k) const { return static_cast<int>(header().dims[k][0]); }
+    int cols(uint32_t k) const { return static_cast<int>(header().dims[k][1]); }
+
+    // El payload es de la ranura del trabajo: el handler puede sobrescribirlo
+    // (p. ej. dgesdd destruye A)
+    template <class T>
+    T* matrix(uint32_t k) const {
+        if (dtype() != dtype_of<T>) throw std::runtime_error("dtype inesperado en la matriz " + std::to_string(k) + " del payload.");
+        return reinterpret_cast<T*>(blob_ + bin_offset(header(), k));
+    }
+
+    // La matriz k en column-major: en sitio si ya lo es (o tiene una sola
+    // columna); si no, transpuesta en scratch
+    template <class T>
+    const T* col_major(uint32_t k, AlignedBuffer<T>& scratch) const {
+        T* p = matrix<T>(k);
+        if (layout() == kLayoutCol || cols(k) == 1) return p;
+        scratch.resize(static_cast<size_t>(rows(k)) * static_cast<size_t>(cols(k)));
+        to_col_major(p, rows(k), cols(k), scratch.data());
+        return scratch.data();
+    }
+
+    // Exige count matrices (mensaje para el cliente si no)
+    void expect(uint32_t n, const char* what) const {
+        if (count() != n)
+            throw std::runtime_error("El payload debe traer " + std::to_string(n) + (n == 1 ? " matriz: " : " matrices: ") + what + ".");
+    }
+
+private:
+    const BinHeader& header() const { return *reinterpret_cast<const BinHeader*>(blob_); }
+
+    char* blob_ = nullptr;
+    size_t size_ = 0;
+};
+
+// Resultados: el handler declara las matrices (mismo dtype y layout, como en
+// MCSM) con shape y las escribe en sitio; trama y payload quedan contiguos
+// en la arena y salen con un solo send.
+class JobOutput {
+public:
+    void reset(Arena& arena) {
+        arena_ = &arena;
+        wire_ = nullptr;
+        size_ = 0;
+    }
+
+    void shape(uint8_t dtype, uint8_t layout, std::initializer_list<std::pair<int, int>> dims) {
+        if (dims.size() > kBinMaxMatrices) throw std::runtime_error("Demasiadas matrices en la respuesta.");
+        BinHeader h = make_header(layout, static_cast<uint32_t>(dims.size()), dtype);
+        uint32_t k = 0;
+        for (const auto& [r, c] : dims) {
+            h.dims[k][0] = static_cast<uint64_t>(r);
+            h.dims[k][1] = static_cast<uint64_t>(c);
+            ++k;
+        }
+        size_ = dims.size() == 0 ? 0 : bin_file_size(h);
+        // La trama va justo antes del payload; el payload queda alineado a 64
+        wire_ = arena_->alloc<char>(kMatrixAlign + size_) + kMatrixAlign - sizeof(JobFrame);
+        if (size_ > 0) std::memcpy(blob(), &h, sizeof(h));
+    }
+
+    template <class T>
+    T* matrix(uint32_t k) {
+        return reinterpret_cast<T*>(blob() + bin_offset(*reinterpret_cast<const BinHeader*>(blob()), k));
+    }
+
+    // Respuesta de error: el mensaje reemplaza el payload
+    void error(const std::string& msg) {
+        size_ = msg.size();
+        wire_ = arena_->alloc<char>(sizeof(JobFrame) + size_);
+        std::memcpy(blob(), msg.data(), size_);
+    }
+
+    char* wire() { return wire_; }
+    size_t payload_size() const { return size_; }
+    char* blob() { return wire_ + sizeof(JobFrame); }
+
+private:
+    Arena* arena_ = nullptr;
+    char* wire_ = nullptr;
+    size_t size_ = 0;
+};
+
+// El handler lee in, resuelve y llena out (o lanza: el mensaje va al cliente)
+using JobHandler = std::function<void(const JobFrame& req, const JobInput& in, JobOutput& out)>;
+
+inline std::runtime_error unsupported_job(const JobFrame& req) {
+    return std::runtime_error("Operación " + std::to_string(req.op) + " no soportada por este servidor.");
+}
+
+// -----------------------------
+// Sockets (POSIX / Winsock)
+// -----------------------------
+#ifdef _WIN32
+using SocketHandle = SOCKET;
+inline constexpr SocketHandle kNoSocket = INVALID_SOCKET;
+inline void close_socket(SocketHandle s) { closesocket(s); }
+inline void shutdown_socket(SocketHandle s) { shutdown(s, SD_BOTH); }
+#else
+using SocketHandle = int;
+inline constexpr SocketHandle kNoSocket = -1;
+inline void close_socket(SocketHandle s) { ::close(s); }
+inline void shutdown_socket(SocketHandle s) { shutdown(s, SHUT_RDWR); }
+#endif
+
+// Lee exactamente n bytes; false si la conexión se cerró o falló
+inline bool recv_all(SocketHandle s, char* p, size_t n) {
+    while (n > 0) {
+        const int chunk = static_cast<int>(std::min<size_t>(n, size_t{1} << 30));
+        const auto got = recv(s, p, chunk, 0);
+        if (got <= 0) return false;
+        p += got;
+        n -= static_cast<size_t>(got);
+    }
+    return true;
+}
+
+inline bool send_all(SocketHandle s, const char* p, size_t n) {
+#ifdef MSG_NOSIGNAL
+    const int flags = MSG_NOSIGNAL; // un cliente que se fue no mata al servidor con SIGPIPE
+#else
+    const int flags = 0;
+#endif
+    while (n > 0) {
+        const int chunk = static_cast<int>(std::min<size_t>(n, size_t{1} << 30));
+        const auto sent = send(s, p, chunk, flags);
+        if (sent <= 0) return false;
+        p += sent;
+        n -= static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+inline SocketHandle listen_on(const std::string& addr) {
+#ifdef _WIN32
+    static const bool wsa_ok = [] {
+        WSADATA wsa;
+        return WSAStartup(MAKEWORD(2, 2), &wsa) == 0;
+    }();
+    if (!wsa_ok) throw std::runtime_error("WSAStartup falló.");
+#endif
+    SocketHandle s = kNoSocket;
+    if (addr.rfind("unix:", 0) == 0) {
+#ifdef _WIN32
+        throw std::runtime_error("Los sockets unix: no están disponibles en Windows; usar tcp:HOST:PUERTO.");
+#else
+        const std::string path = addr.substr(5);
+        sockaddr_un sa{};
+        if (path.empty() || path.size() >= sizeof(sa.sun_path)) throw std::runtime_error("Ruta de socket inválida: " + path);
+        sa.sun_family = AF_UNIX;
+        std::memcpy(sa.sun_path, path.c_str(), path.size() + 1);
+        ::unlink(path.c_str()); // un socket viejo de una ejecución anterior
+        s = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (s == kNoSocket || bind(s, reinterpret_cast<sockaddr*>(&sa), sizeof(sa)) != 0)
+            throw std::runtime_error("No se pudo abrir el socket " + path);
+#endif
+    } else if (addr.rfind("tcp:", 0) == 0) {
+        const size_t colon = addr.rfind(':');
+        const std::string host = addr.substr(4, colon - 4), port = addr.substr(colon + 1);
+        if (colon < 4 || host.empty() || port.empty()) throw std::runtime_error("Dirección TCP inválida (tcp:HOST:PUERTO): " + addr);
+        addrinfo hints{}, *res = nullptr;
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags = AI_PASSIVE;
+        if (getaddrinfo(host.c_str(), port.c_str(), &hints, &res) != 0 || !res)
+            throw std::runtime_error("No se pudo resolver " + addr);
+        s = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+        const int one = 1;
+        if (s != kNoSocket) setsockopt(s, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&one), sizeof(one));
+        const bool ok = s != kNoSocket && bind(s, res->ai_addr, static_cast<int>(res->ai_addrlen)) == 0;
+        freeaddrinfo(res);
+        if (!ok) throw std::runtime_error("No se pudo escuchar en " + addr);
+    } else {
+        throw std::runtime_error("--serve espera unix:RUTA o tcp:HOST:PUERTO, no " + addr);
+    }
+    if (listen(s, 16) != 0) throw std::runtime_error("listen falló en " + addr);
+    return s;
+}
+
+// -----------------------------
+// Una conexión: lectura -> cómputo -> envío
+// -----------------------------
+inline std::mutex& compute_mutex() {
+    static std::mutex mu;
+    return mu;
+}
+
+struct JobSlot {
+    JobFrame frame{};
+    JobInput in;
+    JobOutput out;
+    Arena arena;
+};
+
+inline void serve_connection(SocketHandle s, const JobHandler& handler) {
+    std::array<JobSlot, kServeSlots> slots;
+    BlockingQueue<size_t> free_q(kServeSlots), compute_q(kServeSlots), write_q(kServeSlots);
+    for (size_t i = 0; i < kServeSlots; ++i) free_q.push(i);
+
+    // 1) Lectura: trama y payload directo a la arena de una ranura libre
+    std::thread reader([&] {
+        for (size_t i; free_q.pop(i);) {
+            JobSlot& sl = slots[i];
+            sl.arena.reset();
+            if (!recv_all(s, reinterpret_cast<char*>(&sl.frame), sizeof(JobFrame))) break;
+            if (std::memcmp(sl.frame.magic, kJobMagic, sizeof(kJobMagic)) != 0) {
+                std::cerr << "Servidor: trama inválida, se cierra la conexión.\n";
+                break;
+            }
+            const size_t max_payload = serve_config().max_payload;
+            if (sl.frame.size > max_payload) {
+                // El payload no se lee: se responde el error y se cierra la conexión
+                std::cerr << "Servidor: payload de " << sl.frame.size << " bytes, se cierra la conexión.\n";
+                sl.out.reset(sl.arena);
+                sl.out.error("Payload de " + std::to_string(sl.frame.size) + " bytes: el límite es " +
+                             std::to_string(max_payload >> 20) + " MiB (--max-payload).");
+                compute_q.push(i);
+                break;
+            }
+            char* payload = sl.arena.alloc<char>(static_cast<size_t>(sl.frame.size));
+            if (!recv_all(s, payload, static_cast<size_t>(sl.frame.size))) break;
+            sl.out.reset(sl.arena);
+            try {
+                sl.in.assign(payload, static_cast<size_t>(sl.frame.size));
+            } catch (const std::exception& ex) {
+                sl.out.error(ex.what()); // se responde el error sin pasar por el handler
+            }
+            compute_q.push(i);
+        }
+        compute_q.close();
+    });
+
+    // 3) Envío, en el orden de llegada
+    std::thread writer([&] {
+        bool alive = true;
+        for (size_t i; write_q.pop(i);) {
+            JobSlot& sl = slots[i];
+            JobFrame f = sl.frame;
+            f.size = sl.out.payload_size();
+            std::memcpy(sl.out.wire(), &f, sizeof(f));
+            if (alive && !send_all(s, sl.out.wire(), sizeof(JobFrame) + f.size)) {
+                alive = false;
+                shutdown_socket(s); // el lector sale de recv
+            }
+            free_q.push(i);
+        }
+        free_q.close();
+    });
+
+    // 2) Cómputo en este hilo
+    for (size_t i; compute_q.pop(i);) {
+        JobSlot& sl = slots[i];
+        if (sl.out.wire()) { // error de decodificación
+            sl.frame.status = kJobError;
+        } else {
+            std::lock_guard lock(compute_mutex());
+            try {
+                if (sl.frame.op == kJobPing) sl.out.shape(kDtypeF64, kLayoutRow, {});
+                else handler(sl.frame, sl.in, sl.out);
+                if (!sl.out.wire()) sl.out.shape(kDtypeF64, kLayoutRow, {});
+                sl.frame.status = kJobOk;
+            } catch (const std::exception& ex) {
+                sl.out.error(ex.what());
+                sl.frame.status = kJobError;
+            }
+        }
+        write_q.push(i);
+    }
+    write_q.close();
+    writer.join();
+    reader.join();
+    close_socket(s);
+}
+
+// Acepta conexiones para siempre (un pipeline por conexión)
+inline void serve(const std::string& addr, const JobHandler& handler) {
+    const SocketHandle ls = listen_on(addr);
+    std::cout << "Escuchando en " << addr << std::endl;
+    bool failing = false; // el aviso de accept se imprime una vez por racha
+    for (;;) {
+        SocketHandle c = accept(ls, nullptr, nullptr);
+        if (c == kNoSocket) {
+            // Sin descriptores (EMFILE, ENFILE) o sin memoria, accept falla
+            // enseguida otra vez: se espera en lugar de girar al 100% de CPU
+#ifdef _WIN32
+            const int err = WSAGetLastError();
+            const bool retry_now = err == WSAEINTR || err == WSAECONNRESET;
+            const std::string what = "error " + std::to_string(err);
+#else
+            const int err = errno;
+            const bool retry_now = err == EINTR || err == ECONNABORTED;
+            const std::string what = std::strerror(err);
+#endif
+            if (retry_now) continue;
+            if (!failing) std::cerr << "Servidor: accept falló (" << what << "); se reintenta cada " << kAcceptRetryMs << " ms.\n";
+            failing = true;
+            std::this_thread::sleep_for(std::chrono::milliseconds(kAcceptRetryMs));
+            continue;
+        }
+        if (failing) std::cerr << "Servidor: accept vuelve a funcionar.\n";
+        failing = false;
+        if (addr.rfind("tcp:", 0) == 0) {
+            const int one = 1; // respuestas pequeñas sin esperar a Nagle
+            setsockopt(c, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&one), sizeof(one));
+        }
+        std::thread(serve_connection, c, std::cref(handler)).detach();
+    }
+}
@@ -0,0 +1,115 @@
+// include/mcs/stats.hpp
+// Reporte de tiempos: Stopwatch, pico de RSS y Stats (una línea JSON por
+// ejecución con tiempo, bytes y FLOPs por fase).
+#pragma once
+
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX // evita las macros min/max de windows.h
+#endif
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+// -----------------------------
+// Instrumentación (--stats o MCS_STATS=1)
+//
+// Acumula tiempo de pared, bytes procesados y FLOPs por fase, y al final
+// imprime una sola línea JSON (en stderr) con el throughput de cada fase
+// y el pico de memoria residente (RSS) del proceso.
+// -----------------------------
+class Stopwatch {
+public:
+    Stopwatch() : t0_(std::chrono::steady_clock::now()) {}
+    double seconds() const { return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0_).count(); }
+
+private:
+    std::chrono::steady_clock::time_point t0_;
+};
+
+// Pico de RSS del proceso en bytes (0 si no se puede obtener)
+inline size_t peak_rss_bytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS pmc{};
+    if (K32GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) return pmc.PeakWorkingSetSize;
+    return 0;
+#else
+    struct rusage ru {};
+    if (getrusage(RUSAGE_SELF, &ru) != 0) return 0;
+#ifdef __APPLE__
+    return static_cast<size_t>(ru.ru_maxrss);        // bytes
+#else
+    return static_cast<size_t>(ru.ru_maxrss) * 1024; // KiB
+#endif
+#endif
+}
+
+class Stats {
+public:
+    explicit Stats(bool enabled) : enabled_(enabled) {}
+
+    bool enabled() const { return enabled_; }
+
+    // Acumula en la fase `name` (se crea la primera vez, en orden de aparición)
+    void add(const std::string& name, double seconds, double bytes, double flops = 0.0) {
+        if (!enabled_) return;
+        for (auto& ph : phases_) {
+            if (ph.name == name) {
+                ph.seconds += seconds;
+                ph.bytes += bytes;
+                ph.flops += flops;
+                return;
+            }
+        }
+        phases_.push_back({name, seconds, bytes, flops});
+    }
+
+    // Campo extra de primer nivel; `json_value` ya debe venir en JSON
+    void set(const std::string& key, const std::string& json_value) {
+        if (enabled_) fields_.emplace_back(key, json_value);
+    }
+
+    void print_json(std::ostream& out) const {
+        if (!enabled_) return;
+        std::string s = "{";
+        for (const auto& [k, v] : fields_) s += "\"" + k + "\":" + v + ",";
+        s += "\"phases\":[";
+        for (size_t i = 0; i < phases_.size(); ++i) {
+            const Phase& ph = phases_[i];
+            if (i) s += ",";
+            s += "{\"name\":\"" + ph.name + "\",\"wall_s\":" + num(ph.seconds) +
+                 ",\"bytes\":" + num(ph.bytes) +
+                 ",\"mb_per_s\":" + num(ph.seconds > 0 ? ph.bytes / ph.seconds * 1e-6 : 0.0);
+            if (ph.flops > 0) s += ",\"gflops\":" + num(ph.seconds > 0 ? ph.flops / ph.seconds * 1e-9 : 0.0);
+            s += "}";
+        }
+        s += "],\"total_s\":" + num(total_.seconds()) +
+             ",\"peak_rss_bytes\":" + std::to_string(peak_rss_bytes()) + "}\n";
+        out << s << std::flush;
+    }
+
+    static std::string num(double v) {
+        char buf[32];
+        return std::string(buf, std::to_chars(buf, buf + sizeof(buf), v).ptr);
+    }
+
+private:
+    struct Phase {
+        std::string name;
+        double seconds, bytes, flops;
+    };
+    bool enabled_;
+    Stopwatch total_;
+    std::vector<Phase> phases_;
+    std::vector<std::pair<std::string, std::string>> fields_;
+};
@@ -0,0 +1,202 @@
+// include/mcs/threads.hpp
+// Cantidad de hilos y afinidad, sin depender de BLAS:
+// - max_threads(): hilos de los pools propios (parseo, formato, lotes,
+//   transposición); --threads N lo fija, si no, hardware_concurrency
+// - topología NUMA: CPUs permitidas de cada nodo (Linux: /sys; en Windows,
+//   un solo nodo con las primeras 64 CPUs; en otros sistemas no se fija
+//   afinidad)
+// - bind_worker(t): fija el hilo que lo llama a la CPU de la ranura t según
+//   --bind (close: llena un nodo antes de pasar al siguiente; spread: reparte
+//   las ranuras entre nodos). Sin --bind no hace nada.
+//
+// Los pools llaman bind_worker con el índice de cada hilo, así que con --bind
+// el hilo t de cualquier pool corre en la misma CPU que el hilo t de BLAS, y
+// la memoria que toca primero (first touch) queda en su nodo.
+//
+// BlockingQueue: cola acotada productor/consumidor entre etapas de un
+// pipeline (servidor, E/S solapada con el cómputo).
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX // evita las macros min/max de windows.h
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+enum class Bind { none, close, spread };
+
+inline const char* bind_name(Bind b) {
+    switch (b) {
+    case Bind::none: return "none";
+    case Bind::close: return "close";
+    case Bind::spread: return "spread";
+    }
+    return "?";
+}
+
+struct ThreadConfig {
+    int threads = 0; // 0 => hardware_concurrency
+    Bind bind = Bind::none;
+    std::vector<int> slots; // CPU de cada ranura (solo con bind != none)
+    int numa_nodes = 1;
+};
+
+inline ThreadConfig& thread_config() {
+    static ThreadConfig cfg;
+    return cfg;
+}
+
+inline unsigned max_threads() {
+    const int t = thread_config().threads;
+    return t > 0 ? static_cast<unsigned>(t) : std::max(1u, std::thread::hardware_concurrency());
+}
+
+// -----------------------------
+// Topología: CPUs permitidas por nodo NUMA
+// -----------------------------
+#ifdef __linux__
+// "0-3,8-11" -> {0, 1, 2, 3, 8, 9, 10, 11}
+inline std::vector<int> parse_cpu_list(const char* s) {
+    std::vector<int> cpus;
+    int a = 0, b = 0, used = 0;
+    while (std::sscanf(s, "%d%n", &a, &used) == 1) {
+        s += used;
+        b = a;
+        if (*s == '-' && std::sscanf(s + 1, "%d%n", &b, &used) == 1) s += 1 + used;
+        for (int c = a; c <= b; ++c) cpus.push_back(c);
+        if (*s != ',') break;
+        ++s;
+    }
+    return cpus;
+}
+#endif
+
+inline std::vector<std::vector<int>> numa_topology() {
+    std::vector<int> allowed;
+#ifndef __linux__
+    const unsigned hw = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned c = 0; c < hw && c < 64; ++c) allowed.push_back(static_cast<int>(c));
+    return {allowed};
+#else
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int c = 0; c < CPU_SETSIZE; ++c)
+            if (CPU_ISSET(c, &set)) allowed.push_back(c);
+    }
+    if (allowed.empty()) allowed.push_back(0);
+    std::vector<std::vector<int>> nodes;
+    for (int node = 0;; ++node) {
+        const std::string path = "/sys/devices/system/node/node" + std::to_string(node) + "/cpulist";
+        std::FILE* f = std::fopen(path.c_str(), "r");
+        if (!f) break;
+        char buf[4096] = {};
+        const size_t got = std::fread(buf, 1, sizeof(buf) - 1, f);
+        std::fclose(f);
+        buf[got] = '\0';
+        std::vector<int> cpus;
+        for (int c : parse_cpu_list(buf))
+            if (std::binary_search(allowed.begin(), allowed.end(), c)) cpus.push_back(c);
+        if (!cpus.empty()) nodes.push_back(std::move(cpus));
+    }
+    if (nodes.empty()) nodes.push_back(allowed);
+    return nodes;
+#endif
+}
+
+// CPU de cada una de las n ranuras
+inline std::vector<int> cpu_slots(Bind bind, unsigned n, const std::vector<std::vector<int>>& nodes) {
+    std::vector<int> slots;
+    if (bind == Bind::close) {
+        std::vector<int> all;
+        for (const auto& node : nodes) all.insert(all.end(), node.begin(), node.end());
+        for (unsigned t = 0; t < n; ++t) slots.push_back(all[t % all.size()]);
+    } else if (bind == Bind::spread) {
+        for (unsigned t = 0; t < n; ++t) {
+            const auto& node = nodes[t % nodes.size()];
+            slots.push_back(node[(t / nodes.size()) % node.size()]);
+        }
+    }
+    return slots;
+}
+
+// -----------------------------
+// Afinidad
+// -----------------------------
+inline void bind_this_thread(int cpu) {
+#ifdef _WIN32
+    SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR{1} << cpu);
+#elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void)cpu;
+#endif
+}
+
+inline void bind_worker(unsigned t) {
+    const ThreadConfig& cfg = thread_config();
+    if (cfg.bind == Bind::none || cfg.slots.empty()) return;
+    bind_this_thread(cfg.slots[t % cfg.slots.size()]);
+}
+
+// -----------------------------
+// Cola acotada entre etapas
+//
+// push espera mientras la cola está llena; pop espera mientras está vacía.
+// close despierta a todos: push deja de aceptar y pop devuelve false cuando
+// ya no quedan elementos, así el consumidor termina después del último.
+// -----------------------------
+template <class T>
+class BlockingQueue {
+public:
+    explicit BlockingQueue(size_t capacity) : cap_(std::max<size_t>(1, capacity)) {}
+
+    bool push(T v) {
+        std::unique_lock lock(mu_);
+        not_full_.wait(lock, [&] { return closed_ || items_.size() < cap_; });
+        if (closed_) return false;
+        items_.push_back(std::move(v));
+        not_empty_.notify_one();
+        return true;
+    }
+
+    bool pop(T& v) {
+        std::unique_lock lock(mu_);
+        not_empty_.wait(lock, [&] { return closed_ || !items_.empty(); });
+        if (items_.empty()) return false;
+        v = std::move(items_.front());
+        items_.pop_front();
+        not_full_.notify_one();
+        return true;
+    }
+
+    void close() {
+        std::lock_guard lock(mu_);
+        closed_ = true;
+        not_full_.notify_all();
+        not_empty_.notify_all();
+    }
+
+private:
+    std::mutex mu_;
+    std::condition_variable not_full_, not_empty_;
+    std::deque<T> items_;
+    size_t cap_;
+    bool closed_ = false;
+};
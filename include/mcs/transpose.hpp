@@ -0,0 +1,113 @@
+// include/mcs/transpose.hpp
+// Transposición por bloques y conversión de layout (row-major <-> column-major),
+// más parallel_for_tiles, el reparto de bloques entre hilos que usan también
+// los parsers y la evaluación de modelos.
+#pragma once
+
+#include "threads.hpp" // max_threads, bind_worker
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// -----------------------------
+// Transposición por bloques (conversión row-major <-> column-major)
+//
+// Solo hace falta cuando un consumidor exige otro layout (p. ej. --to-bin
+// --layout col): DGEMM trabaja sin copias. El bucle doble ingenuo escribe
+// con paso `rows` y satura caché y TLB; aquí se recorre por bloques de
+// kTransposeTile×kTransposeTile (caben en L1/L2) y, dentro, por micro-bloques
+// 8×8 que se cargan por filas y se guardan por filas (accesos contiguos que
+// el compilador vectoriza). Los bloques se reparten entre hilos.
+// -----------------------------
+inline constexpr int    kTransposeTile           = 64;
+inline constexpr int    kTransposeMicro          = 8;
+inline constexpr size_t kParallelTransposeMinElems = size_t{1} << 20;
+
+// Micro-bloque: dst[j][i] = src[i][j] para i < r, j < c (r, c <= 8)
+template <class T>
+inline void transpose_micro(const T* __restrict src, size_t lds, T* __restrict dst, size_t ldd, int r, int c) {
+    constexpr int B = kTransposeMicro;
+    if (r == B && c == B) {
+        T tmp[B][B];
+        for (int i = 0; i < B; ++i)
+            for (int j = 0; j < B; ++j) tmp[j][i] = src[i * lds + j];
+        for (int j = 0; j < B; ++j)
+            for (int i = 0; i < B; ++i) dst[j * ldd + i] = tmp[j][i];
+        return;
+    }
+    for (int i = 0; i < r; ++i)
+        for (int j = 0; j < c; ++j) dst[j * ldd + i] = src[i * lds + j];
+}
+
+// Ejecuta fn(t) para t en [0, count), repartido entre hilos si work es grande
+template <class F>
+inline void parallel_for_tiles(size_t count, size_t work, F&& fn) {
+    const unsigned hw = max_threads();
+    const unsigned nthreads = work < kParallelTransposeMinElems
+                                  ? 1u
+                                  : static_cast<unsigned>(std::min<size_t>(hw, count));
+    std::atomic<size_t> next{0};
+    auto worker = [&](unsigned w) {
+        if (nthreads > 1) bind_worker(w);
+        for (size_t t; (t = next.fetch_add(1)) < count;) fn(t);
+    };
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < nthreads; ++t) pool.emplace_back(worker, t);
+    worker(0);
+    for (auto& th : pool) th.join();
+}
+
+// dst (cols×rows, row-major) = src^T, con src (rows×cols, row-major)
+template <class T>
+inline void transpose(const T* src, int rows, int cols, T* dst) {
+    constexpr int TB = kTransposeTile, B = kTransposeMicro;
+    const size_t tile_rows = (static_cast<size_t>(rows) + TB - 1) / TB;
+    parallel_for_tiles(tile_rows, static_cast<size_t>(rows) * cols, [&](size_t t) {
+        const int i0 = static_cast<int>(t) * TB, i1 = std::min(rows, i0 + TB);
+        for (int j0 = 0; j0 < cols; j0 += TB) {
+            const int j1 = std::min(cols, j0 + TB);
+            for (int i = i0; i < i1; i += B)
+                for (int j = j0; j < j1; j += B)
+                    transpose_micro(src + static_cast<size_t>(i) * cols + j, static_cast<size_t>(cols),
+                                    dst + static_cast<size_t>(j) * rows + i, static_cast<size_t>(rows),
+                                    std::min(B, i1 - i), std::min(B, j1 - j));
+        }
+    });
+}
+
+// Transpone en sitio una matriz cuadrada (n×n): intercambia cada par de
+// micro-bloques (I,J)/(J,I) por encima de la diagonal y transpone los diagonales
+template <class T>
+inline void transpose_inplace_square(T* a, int n) {
+    constexpr int B = kTransposeMicro;
+    const size_t ld = static_cast<size_t>(n);
+    const size_t block_rows = (ld + B - 1) / B;
+    parallel_for_tiles(block_rows, ld * ld, [&](size_t t) {
+        const int i = static_cast<int>(t) * B, r = std::min(B, n - i);
+        // Bloque diagonal
+        for (int x = 0; x < r; ++x)
+            for (int y = x + 1; y < r; ++y) std::swap(a[(i + x) * ld + i + y], a[(i + y) * ld + i + x]);
+        // Pares (I,J) con J > I: cada hilo toca solo su fila de bloques y la columna simétrica
+        for (int j = i + B; j < n; j += B) {
+            const int c = std::min(B, n - j);
+            T upper[B * B], lower[B * B];
+            transpose_micro(a + i * ld + j, ld, lower, B, r, c); // (I,J)^T  (c×r)
+            transpose_micro(a + j * ld + i, ld, upper, B, c, r); // (J,I)^T  (r×c)
+            for (int x = 0; x < r; ++x)
+                for (int y = 0; y < c; ++y) a[(i + x) * ld + j + y] = upper[x * B + y];
+            for (int y = 0; y < c; ++y)
+                for (int x = 0; x < r; ++x) a[(j + y) * ld + i + x] = lower[y * B + x];
+        }
+    });
+}
+
+// Copias de layout: row-major (rows×cols) -> column-major y viceversa
+template <class T>
+inline void to_col_major(const T* rm, int rows, int cols, T* cm) { transpose(rm, rows, cols, cm); }
+
+template <class T>
+inline void to_row_major(const T* cm, int rows, int cols, T* rm) { transpose(cm, cols, rows, rm); }